@@ -0,0 +1,108 @@
+/*
+Robert Hijmans
+2026
+
+License: GNU General Public License (GNU GPL) v. 2
+*/
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include "binout.h"
+
+
+static void put_u32(std::vector<char> &h, uint32_t x) {
+	for (int i=0; i<4; i++) {
+		h.push_back(char((x >> (8*i)) & 0xFF));
+	}
+}
+
+static void put_string(std::vector<char> &h, const std::string &s) {
+	put_u32(h, s.size());
+	h.insert(h.end(), s.begin(), s.end());
+}
+
+
+// the header for nc names and nr rows
+static std::vector<char> header(const std::vector<std::string> &names, size_t nr, const std::string &meta, bool single) {
+	const char magic[8] = {'W', 'O', 'F', 'O', 'S', 'T', 'B', 0};
+	std::vector<char> h(magic, magic + 8);
+	put_u32(h, 0); // header size, set below
+	put_u32(h, 1);
+	put_u32(h, names.size());
+	put_u32(h, nr);
+	put_u32(h, single ? 4 : 8);
+	for (size_t j=0; j<names.size(); j++) {
+		put_string(h, names[j]);
+	}
+	put_string(h, meta);
+	h.resize((h.size() + 7) / 8 * 8, 0);
+	uint32_t hsize = h.size();
+	for (int i=0; i<4; i++) {
+		h[8+i] = char((hsize >> (8*i)) & 0xFF);
+	}
+	return h;
+}
+
+static bool put_values(FILE *f, const double *v, size_t n, bool single) {
+	if (single) {
+		std::vector<float> x(v, v + n);
+		return fwrite(x.data(), sizeof(float), n, f) == n;
+	}
+	return fwrite(v, sizeof(double), n, f) == n;
+}
+
+
+bool writeBinaryOutput(const char *filename, const WofostOutput &out, const std::string &meta, bool single) {
+	size_t nc = out.names.size();
+	size_t nr = out.nrow;
+	if (out.values.size() < nc * nr) return false;
+
+	std::vector<char> h = header(out.names, nr, meta, single);
+	FILE *f = fopen(filename, "wb");
+	if (f == NULL) return false;
+	bool ok = fwrite(h.data(), 1, h.size(), f) == h.size();
+	// the output is column-major, so the columns can be written as they are
+	ok = ok && put_values(f, out.values.data(), nc * nr, single);
+	ok = (fclose(f) == 0) && ok;
+	return ok;
+}
+
+
+bool writeBinaryRuns(const char *filename, const std::vector<WofostOutput> &runs, const std::string &meta, bool single) {
+	std::vector<std::string> names(1, "run");
+	for (size_t i=0; i<runs.size(); i++) {
+		if (runs[i].names.size() > 0) {
+			names.insert(names.end(), runs[i].names.begin(), runs[i].names.end());
+			break;
+		}
+	}
+	size_t nc = names.size();
+	// the runs that are written
+	std::vector<size_t> use;
+	size_t nr = 0;
+	for (size_t i=0; i<runs.size(); i++) {
+		const WofostOutput &o = runs[i];
+		if ((o.nrow == 0) || (o.names.size() != nc-1) || (o.values.size() < (nc-1) * o.nrow)) continue;
+		use.push_back(i);
+		nr += o.nrow;
+	}
+
+	std::vector<char> h = header(names, nr, meta, single);
+	FILE *f = fopen(filename, "wb");
+	if (f == NULL) return false;
+	bool ok = fwrite(h.data(), 1, h.size(), f) == h.size();
+	std::vector<double> run;
+	for (size_t i : use) {
+		run.assign(runs[i].nrow, double(i+1));
+		ok = ok && put_values(f, run.data(), run.size(), single);
+	}
+	for (size_t j=0; j<nc-1; j++) {
+		for (size_t i : use) {
+			const WofostOutput &o = runs[i];
+			ok = ok && put_values(f, o.values.data() + j * o.nrow, o.nrow, single);
+		}
+	}
+	ok = (fclose(f) == 0) && ok;
+	return ok;
+}
@@ -0,0 +1,36 @@
+/*
+Robert Hijmans
+2026
+
+License: GNU General Public License (GNU GPL) v. 2
+*/
+
+#ifndef BINOUT_H_
+#define BINOUT_H_
+
+#include <string>
+#include <vector>
+#include "wofost.h"
+
+/*
+Binary columnar output (little-endian):
+	char[8]  "WOFOSTB\0"
+	uint32   header size in bytes (offset of the first column, a multiple of 8)
+	uint32   format version (1)
+	uint32   number of columns
+	uint32   number of rows
+	uint32   bytes per value: 8 (float64) or 4 (float32)
+	for each column: uint32 length of the name, the name
+	uint32   length of the metadata, the metadata ("key=value" lines)
+	zeros up to the header size
+	the columns, one after the other
+Read with Rwofost::read_wofost_binary
+*/
+bool writeBinaryOutput(const char *filename, const WofostOutput &out, const std::string &meta, bool single);
+
+// the outputs of several runs (with the same names) in one file, with a
+// first column "run" (1, 2, ...). Runs without output are skipped. The
+// runs are written as they are, without combining them first
+bool writeBinaryRuns(const char *filename, const std::vector<WofostOutput> &runs, const std::string &meta, bool single);
+
+#endif
@@ -1,4 +1,5 @@
-g++ -std=c++11 -I ../src/ date.cpp files.cpp ../src/astro.cpp ../src/cropsi.cpp ../src/evtra.cpp ../src/penman.cpp ../src/rootd.cpp ../src/soil.cpp ../src/stday.cpp ../src/subsol.cpp ../src/totass.cpp ../src/vernalisation.cpp ../src/watfd.cpp ../src/watgw.cpp ../src/watpp.cpp  ../src/wofost.cpp main.cpp -o WOFOST.exe
+g++ -std=c++17 -pthread -I ../src/ date.cpp files.cpp csvsink.cpp binout.cpp mapfile.cpp weather.cpp ../src/astro.cpp ../src/cropsi.cpp ../src/evtra.cpp ../src/penman.cpp ../src/rootd.cpp ../src/soil.cpp ../src/stday.cpp ../src/subsol.cpp ../src/totass.cpp ../src/vernalisation.cpp ../src/watfd.cpp ../src/watgw.cpp ../src/watpp.cpp  ../src/wofost.cpp main.cpp -o WOFOST.exe
+g++ -std=c++17 -I ../src/ mapfile.cpp weather.cpp convert.cpp -o wofost-convert.exe
 
 @echo off
 rem ../src/npk_demand_uptake.cpp ../src/npk_dynamics.cpp ../src/npk_soil_dynamics.cpp ../src/npk_translocation.cpp ../src/npk_stress.cpp
\ No newline at end of file
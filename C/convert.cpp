@@ -0,0 +1,36 @@
+/*
+Robert Hijmans
+2026
+
+License: GNU General Public License (GNU GPL) v. 2
+
+wofost-convert writes a binary cache for each weather csv file
+(see weather.h). The CLI reads the cache instead of the csv file if it
+is not older than the csv file.
+
+wofost-convert weather1.csv [weather2.csv ...]
+*/
+
+#include <iostream>
+#include "weather.h"
+
+
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		std::cout << "Usage: wofost-convert weather.csv [weather2.csv ...]" << std::endl;
+		return 1;
+	}
+	int nfail = 0;
+	for (int i=1; i<argc; i++) {
+		WofostWeather wth;
+		std::string msg;
+		std::string cache = weatherCacheName(argv[i]);
+		if (readWeatherCSV(argv[i], wth, msg) && writeWeatherCache(cache.c_str(), wth, msg)) {
+			std::cout << wth.date.size() << " days written to: " << cache << std::endl;
+		} else {
+			std::cout << argv[i] << ": " << msg << std::endl;
+			nfail++;
+		}
+	}
+	return nfail > 0 ? 1 : 0;
+}
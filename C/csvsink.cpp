@@ -0,0 +1,81 @@
+/*
+Robert Hijmans
+2026
+
+License: GNU General Public License (GNU GPL) v. 2
+*/
+
+#include <cstdio>
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
+#include "csvsink.h"
+
+// the longest number with "%f" (-DBL_MAX) has 317 characters
+static const size_t maxnumber = 320;
+
+static char* format_number(char *p, char *end, double x) {
+#ifdef __cpp_lib_to_chars
+	return std::to_chars(p, end, x, std::chars_format::fixed, 6).ptr;
+#else
+	return p + snprintf(p, end - p, "%f", x);
+#endif
+}
+
+
+CSVSink::CSVSink(const char *filename) : buf(1 << 16) {
+	outfile.open(filename, std::ios::binary);
+}
+
+CSVSink::~CSVSink() {
+	finish();
+}
+
+void CSVSink::write() {
+	outfile.write(buf.data(), pos);
+	pos = 0;
+}
+
+void CSVSink::start(const std::vector<std::string> &names) {
+	nrow = 0;
+	head.clear();
+	for (size_t i=0; i<names.size(); i++) {
+		if (i > 0) head += ',';
+		head += names[i];
+	}
+	head += '\n';
+	outfile.write(head.data(), head.size());
+}
+
+void CSVSink::row(const double *v, size_t n) {
+	put(NULL, v, n);
+}
+
+void CSVSink::row(long id, const double *v, size_t n) {
+	put(&id, v, n);
+}
+
+void CSVSink::put(const long *id, const double *v, size_t n) {
+	size_t need = (n + 1) * (maxnumber + 1) + 1;
+	if (buf.size() < need) buf.resize(need);
+	if (buf.size() - pos < need) write();
+	char *p = buf.data() + pos;
+	char *end = buf.data() + buf.size();
+	if (id != NULL) {
+		p += snprintf(p, end - p, "%ld", *id);
+		if (n > 0) *p++ = ',';
+	}
+	for (size_t j=0; j<n; j++) {
+		if (j > 0) *p++ = ',';
+		p = format_number(p, end, v[j]);
+	}
+	*p++ = '\n';
+	if (nrow < nhead) head.append(buf.data() + pos, p);
+	pos = p - buf.data();
+	nrow++;
+}
+
+void CSVSink::finish() {
+	if (pos > 0) write();
+	outfile.flush();
+}
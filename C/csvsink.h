@@ -0,0 +1,43 @@
+/*
+Robert Hijmans
+2026
+
+License: GNU General Public License (GNU GPL) v. 2
+*/
+
+#ifndef CSVSINK_H_
+#define CSVSINK_H_
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "wofost.h"
+
+// writes the output rows to a csv file while the model runs. The rows
+// are formatted (as std::to_string does, with 6 decimals) into a buffer
+// that is written to the file when it is full, not after each row
+class CSVSink : public WofostOutputSink {
+public:
+	CSVSink(const char *filename);
+	~CSVSink();
+	bool ok() { return outfile.is_open(); }
+
+	// the header and the first rows, to show on screen
+	std::string head;
+	size_t nhead = 5;
+	size_t nrow = 0;
+
+	void start(const std::vector<std::string> &names);
+	void row(const double *v, size_t n);
+	// a row that starts with an integer (e.g. the number of a run)
+	void row(long id, const double *v, size_t n);
+	void finish();
+private:
+	std::ofstream outfile;
+	std::vector<char> buf;
+	size_t pos = 0;
+	void write();
+	void put(const long *id, const double *v, size_t n);
+};
+
+#endif
@@ -45,23 +45,44 @@ std::string getFileExtension(std::string filename) {
 
 // Jim M.
 // http://stackoverflow.com/questions/1120140/how-can-i-read-and-parse-csv-files-in-c
+// a cell in double quotes can have commas, and "" for a quote
+std::vector<std::string> splitCSVLine(const std::string &line) {
+	std::vector<std::string> row;
+	std::string cell;
+	bool quoted = false;
+	for (size_t i=0; i<line.size(); i++) {
+		char c = line[i];
+		if (quoted) {
+			if (c != '"') {
+				cell += c;
+			} else if ((i+1 < line.size()) && (line[i+1] == '"')) {
+				cell += c;
+				i++;
+			} else {
+				quoted = false;
+			}
+		} else if (c == '"') {
+			quoted = true;
+		} else if (c == ',') {
+			row.push_back(cell);
+			cell.clear();
+		} else {
+			cell += c;
+		}
+	}
+	row.push_back(cell);
+	return row;
+}
+
 std::vector< std::vector<std::string> > readCSV(std::string filename ) {
     std::ifstream file( filename.c_str() );
     std::vector< std::vector<std::string> > matrix;
-    std::vector<std::string>   row;
     std::string line;
-    std::string cell;
-
-    while( file ) {
-        std::getline(file,line);
-        std::stringstream lineStream(line);
-        row.clear();
 
-        while( std::getline( lineStream, cell, ',' ) )
-            row.push_back( cell );
-
-        if( !row.empty() )
-            matrix.push_back( row );
+    while( std::getline(file, line) ) {
+        if (!line.empty() && (line[line.size()-1] == '\r')) line.erase(line.size()-1);
+        if (line.empty()) continue;
+        matrix.push_back( splitCSVLine(line) );
     }
 
 	return(matrix);
@@ -122,7 +143,21 @@ std::vector<std::string> readINIfile(const char* filename) {
 
 
 
-std::vector<std::vector<std::string> > readINI(const char* filename) {
+void INI::add(const std::string &name, const std::string &value) {
+	// the first value is used if a name occurs more than once
+	if (index.emplace(name, names.size()).second) {
+		names.push_back(name);
+		values.push_back(value);
+	}
+}
+
+const std::string* INI::find(const std::string &name) const {
+	std::unordered_map<std::string, size_t>::const_iterator i = index.find(name);
+	return i == index.end() ? NULL : &values[i->second];
+}
+
+
+INI readINI(const char* filename) {
 	std::ifstream file(filename);
     if(file.fail()){
 		std::cout << filename << " not found" << std::endl;
@@ -134,21 +169,17 @@ std::vector<std::vector<std::string> > readINI(const char* filename) {
 	}
 
 	std::vector<std::string> ss;
-	std::vector<std::vector<std::string> > ini(2, std::vector<std::string>(s.size()));
-
-	int k = 0;
+	INI ini;
+	ini.names.reserve(s.size());
+	ini.values.reserve(s.size());
 	int size = s.size();
 	for (int i=0; i < size; i++){
 		//skips comments and lines starting with brackets (i.e. section dividers)
 		if( s[i][0] == '#' || s[i][0] == '[') continue;
 		ss = split(s[i], '=');
 		if (ss.size() <= 1) continue;
-		ini[0][k] = ss[0];
-		ini[1][k] = ss[1];
-		k++;
+		ini.add(ss[0], ss[1]);
 	}
-	ini[0].resize(k);
-	ini[1].resize(k);
 	return(ini);
 }
 
@@ -178,17 +209,14 @@ std::vector<double> StrVecToDVec(const std::string &s) {
 
 std::vector<std::string> getINIvalues(const char* filename, std::vector<std::string> ininames) {
 
-	std::vector<std::vector<std::string> > ini = readINI(filename);
-	std::vector<std::string> names = ini[0];
-	std::vector<std::string> values = ini[1];
+	INI ini = readINI(filename);
 	std::vector<std::string> out(ininames.size());
-	int size = names.size();
 	int loopsize = 	ininames.size();
 	for (int i=0; i < loopsize; i++) {
 		//std::string("LAIi")
-		int p = find(names.begin(), names.end(), ininames[i]) - names.begin();
-		if ( p < size) {
-			out[i] = values[p];
+		const std::string *v = ini.find(ininames[i]);
+		if (v != NULL) {
+			out[i] = *v;
 		} else {
 			out[i] = "-9999";
 		}
@@ -196,13 +224,11 @@ std::vector<std::string> getINIvalues(const char* filename, std::vector<std::str
 	return(out);
 }
 
-double dFromINI(std::vector<std::vector<std::string> > ini, std::string name, double def) {
+double dFromINI(const INI &ini, const std::string &name, double def) {
 	double out;
-	int p = find(ini[0].begin(), ini[0].end(), name) - ini[0].begin();
-
-	int inisize = ini[0].size();
-	if ( p < inisize) {
-		out = strtod(ini[1][p].c_str(), NULL);
+	const std::string *v = ini.find(name);
+	if (v != NULL) {
+		out = strtod(v->c_str(), NULL);
 	} else {
         if (!std::isnan(def)) {
             out = def;
@@ -214,12 +240,11 @@ double dFromINI(std::vector<std::vector<std::string> > ini, std::string name, do
 	return(out);
 }
 
-std::vector<std::vector<double> > mFromINI(std::vector<std::vector<std::string> > ini, std::string name) {
+std::vector<std::vector<double> > mFromINI(const INI &ini, const std::string &name) {
 	std::vector<std::vector<double> > out;
-	int p = find(ini[0].begin(), ini[0].end(), name) - ini[0].begin();
-	int inisize = ini[0].size();
-	if ( p < inisize) {
-		out = StrVecToMatrix(ini[1][p]);
+	const std::string *v = ini.find(name);
+	if (v != NULL) {
+		out = StrVecToMatrix(*v);
 	} else {
 		std::cout << "missing parameter: " << name << std::endl;
         exit(1);
@@ -227,15 +252,13 @@ std::vector<std::vector<double> > mFromINI(std::vector<std::vector<std::string>
 	return(out);
 }
 
-date dateFromINI(std::vector<std::vector<std::string> > ini, std::string name) {
+date dateFromINI(const INI &ini, const std::string &name) {
 	//double out;
-	int p = find(ini[0].begin(), ini[0].end(), name) - ini[0].begin();
+	const std::string *v = ini.find(name);
 	std::vector<std::string> ss;
 	date dates;
-
-	int inisize = ini[0].size();
-	if ( p < inisize) {
-		ss = split(ini[1][p], '-');
+	if (v != NULL) {
+		ss = split(*v, '-');
 		dates.set_year( std::stoi(ss[0].c_str()) );
 		dates.set_month( std::stoi(ss[1].c_str()) );
 		dates.set_day( std::stoi(ss[2].c_str()) );
@@ -247,16 +270,25 @@ date dateFromINI(std::vector<std::vector<std::string> > ini, std::string name) {
 	return(dates);
 }
 
-bool bFromINI(std::vector<std::vector<std::string> > ini, std::string name) {
+bool stringToBool(const std::string &s, bool &b) {
+	if ((s == "true") || (s == "1")) {
+		b = true;
+	} else if ((s == "false") || (s == "0")) {
+		b = false;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+bool bFromINI(const INI &ini, const std::string &name) {
 	bool out;
-	int p = find(ini[0].begin(), ini[0].end(), name) - ini[0].begin();
-
-	int inisize = ini[0].size();
-	if ( p < inisize) {
-		if(ini[1][p] == "true")
-			out = true;
-		else
-			out = false;
+	const std::string *v = ini.find(name);
+	if (v != NULL) {
+		if (!stringToBool(*v, out)) {
+			std::cout << "invalid " << name << ": " << *v << " (use true, false, 1 or 0)" << std::endl;
+			exit(1);
+		}
 	} else {
 		std::cout << "missing parameter: " << name << std::endl;
         exit(1);
@@ -264,13 +296,11 @@ bool bFromINI(std::vector<std::vector<std::string> > ini, std::string name) {
 	return(out);
 }
 
-std::string sFromINI(std::vector<std::vector<std::string> > ini, std::string name, std::string def) {
+std::string sFromINI(const INI &ini, const std::string &name, const std::string &def) {
 	std::string out;
-	int p = find(ini[0].begin(), ini[0].end(), name) - ini[0].begin();
-
-	int inisize = ini[0].size();
-	if ( p < inisize) {
-		out = ini[1][p].c_str();
+	const std::string *v = ini.find(name);
+	if (v != NULL) {
+		out = v->c_str();
 	} else {
 	    if (def != "") {
             out = def;
@@ -282,13 +312,11 @@ std::string sFromINI(std::vector<std::vector<std::string> > ini, std::string nam
 	return(out);
 }
 
-int iFromINI(std::vector<std::vector<std::string> > ini, std::string name) {
+int iFromINI(const INI &ini, const std::string &name) {
 	int out;
-	int p = find(ini[0].begin(), ini[0].end(), name) - ini[0].begin();
-
-	int inisize = ini[0].size();
-	if ( p < inisize) {
-		out = std::stoi( ini[1][p].c_str() );
+	const std::string *v = ini.find(name);
+	if (v != NULL) {
+		out = std::stoi( v->c_str() );
 	} else {
 		std::cout << "missing parameter: " << name << std::endl;
         exit(1);
@@ -296,12 +324,11 @@ int iFromINI(std::vector<std::vector<std::string> > ini, std::string name) {
 	return(out);
 }
 
-std::vector<double> dvFromINI(std::vector<std::vector<std::string> > ini, std::string name) {
+std::vector<double> dvFromINI(const INI &ini, const std::string &name) {
     std::vector<double> out;
-    int p = find(ini[0].begin(), ini[0].end(), name) - ini[0].begin();
-    int inisize = ini[0].size();
-    if ( p < inisize) {
-        out = StrVecToDVec(ini[1][p]);
+    const std::string *v = ini.find(name);
+    if (v != NULL) {
+        out = StrVecToDVec(*v);
     } else {
         std::cout << "missing parameter: " << name << std::endl;
         exit(1);
@@ -1,17 +1,39 @@
+#ifndef FILES_H_
+#define FILES_H_
+
 #include "date.h"
 #include <cmath>  //NAN,isnan
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// the name = value pairs of an ini file, with a hash index of the names
+class INI {
+public:
+	std::vector<std::string> names, values;
+	std::unordered_map<std::string, size_t> index;
+	void add(const std::string &name, const std::string &value);
+	// the value for name, or NULL if there is no such name
+	const std::string* find(const std::string &name) const;
+};
 
 std::vector<std::string> split(const std::string &s, char delim);
 std::vector<std::string> &split(const std::string &s, char delim, std::vector<std::string> &elems);
+std::vector<std::string> splitCSVLine(const std::string &line);
 std::vector< std::vector<std::string> > readCSV(std::string);
-std::vector<std::vector<std::string> > readINI(const char* filename);
-std::vector<std::vector<double> > mFromINI(std::vector<std::vector<std::string> > ini, std::string name);
-date dateFromINI(std::vector<std::vector<std::string> > ini, std::string name);
-bool bFromINI(std::vector<std::vector<std::string> > ini, std::string name);
-int iFromINI(std::vector<std::vector<std::string> > ini, std::string name);
-std::vector<double> dvFromINI(std::vector<std::vector<std::string> > ini, std::string name);
+std::string getFileExtension(std::string filename);
+INI readINI(const char* filename);
+std::vector<std::vector<double> > mFromINI(const INI &ini, const std::string &name);
+date dateFromINI(const INI &ini, const std::string &name);
+// "true" or "1", "false" or "0"; false if s is none of these
+bool stringToBool(const std::string &s, bool &b);
+bool bFromINI(const INI &ini, const std::string &name);
+int iFromINI(const INI &ini, const std::string &name);
+std::vector<double> dvFromINI(const INI &ini, const std::string &name);
 std::vector<double> StrVecToDVec(const std::string &s);
 
-//std::string sFromINI(std::vector<std::vector<std::string> > ini, std::string name);
-std::string sFromINI(std::vector<std::vector<std::string> > ini, std::string name, std::string def="");
-double dFromINI(std::vector<std::vector<std::string> > ini, std::string name, double def=NAN);
+//std::string sFromINI(const INI &ini, const std::string &name);
+std::string sFromINI(const INI &ini, const std::string &name, const std::string &def="");
+double dFromINI(const INI &ini, const std::string &name, double def=NAN);
+
+#endif
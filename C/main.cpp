@@ -1,18 +1,19 @@
 #include <vector>
 #include <fstream>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
 #include "wofost.h"
-#include "date.h"
 #include "files.h"
+#include "csvsink.h"
+#include "binout.h"
+#include "weather.h"
 
 
-int date2int (date x) {
-	date s(1970, 1, 1);
-	return x - s;
-}
-
 // crop parameters
 WofostCrop getCropParameters(const char *filename) {
-	std::vector<std::vector<std::string> > crop = readINI(filename);
+	INI crop = readINI(filename);
 
 	WofostCrop crp;
 
@@ -78,7 +79,7 @@ WofostCrop getCropParameters(const char *filename) {
 
 // soil parameters
 WofostSoil getSoilParameters(const char *filename) {
-	std::vector<std::vector<std::string> > soil = readINI(filename);
+	INI soil = readINI(filename);
 
 	WofostSoil sol;
 
@@ -118,38 +119,62 @@ WofostSoil getSoilParameters(const char *filename) {
 
 // weather
 WofostWeather getWeatherParameters(const char *filename) {
-
-	std::vector< std::vector<std::string> > matrix = readCSV(filename);
-
 	WofostWeather wth;
-	date dates;
-
-	std::vector<std::string> ss;
-	for (size_t i = 1; i < matrix.size(); i++) { // skips first line of file
-
-		ss = split(matrix[i][0], '-');
-		dates.set_year( std::stoi(ss[0].c_str()) );
-		dates.set_month( std::stoi(ss[1].c_str()) );
-		dates.set_day( std::stoi(ss[2].c_str()) );
-		int intdate = date2int(dates);
-		wth.date.push_back( intdate );
-		wth.srad.push_back( std::stod(matrix[i][1]) );
-		wth.tmin.push_back( std::stod(matrix[i][2]) );
-		wth.tmax.push_back( std::stod(matrix[i][3]) );
-		wth.vapr.push_back( std::stod(matrix[i][4]) );
-		wth.wind.push_back( std::stod(matrix[i][5]) );
-		wth.prec.push_back( std::stod(matrix[i][6]) );
-	} // ordering should not matter
-
+	std::string msg;
+	if (!readWeather(filename, wth, msg)) {
+		std::cout << msg << std::endl;
+		exit(1);
+	}
 	return wth;
 }
 
-// control parameters
+// a date (yyyy-mm-dd), a list of dates, or a range "from:to:days" (the
+// number of days between the dates, 1 if omitted); or a list of these
+std::vector<long> dateList(const std::string &s) {
+	std::vector<long> out;
+	std::vector<std::string> items = split(s, ',');
+	for (size_t i=0; i<items.size(); i++) {
+		std::vector<std::string> r = split(items[i], ':');
+		std::vector<long> d;
+		for (size_t j=0; (j<r.size()) && (j<2); j++) {
+			std::vector<std::string> ss = split(r[j], '-');
+			if (ss.size() != 3) {
+				std::cout << "invalid date: " << r[j] << std::endl;
+				exit(1);
+			}
+			d.push_back(daysFromCivil(std::stoi(ss[0]), std::stoi(ss[1]), std::stoi(ss[2])));
+		}
+		if (d.size() == 1) {
+			out.push_back(d[0]);
+		} else if (d.size() == 2) {
+			long by = r.size() > 2 ? std::stol(r[2]) : 1;
+			if ((by < 1) || (d[1] < d[0])) {
+				std::cout << "invalid date range: " << items[i] << std::endl;
+				exit(1);
+			}
+			for (long x=d[0]; x<=d[1]; x+=by) out.push_back(x);
+		}
+	}
+	if (out.empty()) {
+		std::cout << "invalid date: " << s << std::endl;
+		exit(1);
+	}
+	return out;
+}
+
+// the modelstart dates and CO2 values in a control file; more than one
+// of either is a sweep
+void sweepValues(const char *filename, std::vector<long> &starts, std::vector<double> &co2) {
+	INI control = readINI(filename);
+	starts = dateList(sFromINI(control, "modelstart"));
+	co2 = dvFromINI(control, "CO2");
+}
+
+// control parameters (the first modelstart and CO2 of a sweep)
 WofostControl getControlParameters(const char *filename) {
 	WofostControl tim;
-	std::vector<std::vector<std::string> > control = readINI(filename);
-	date start = dateFromINI(control, "modelstart");
-    tim.modelstart = date2int(start);
+	INI control = readINI(filename);
+    tim.modelstart = dateList(sFromINI(control, "modelstart"))[0];
     tim.cropstart = iFromINI(control, "cropstart");
     tim.output_option = sFromINI(control, "output", "default");
 	tim.water_limited = bFromINI(control, "water_limited");
@@ -157,6 +182,7 @@ WofostControl getControlParameters(const char *filename) {
 	tim.ISTCHO = iFromINI(control, "start_sowing");
 	tim.stop_maturity = iFromINI(control, "stop_maturity");
 	tim.IDURMX = iFromINI(control, "max_duration");
+	tim.subsol_table = std::stoi(sFromINI(control, "subsol_table", "0"));
 //	date emergence = dateFromINI(control, "emergence") );
 	tim.latitude  = dFromINI(control, "latitude");
 	tim.elevation = dFromINI(control, "elevation");
@@ -170,44 +196,401 @@ WofostControl getControlParameters(const char *filename) {
 
 
 std::vector<std::string> getFiles(char *filename)  {
-	std::vector<std::vector<std::string> > ini = readINI(filename);
+	INI ini = readINI(filename);
 	std::vector<std::string> files;
 	files.push_back( sFromINI(ini, "crop") );
 	files.push_back( sFromINI(ini, "weather") );
 	files.push_back( sFromINI(ini, "soil") );
 	files.push_back( sFromINI(ini, "control") );
 	files.push_back( sFromINI(ini, "output") );
+	// csv, float64 or float32
+	files.push_back( sFromINI(ini, "output_format", "csv") );
 	return files;
 }
 
-void writeOutput(const char *filename, WofostModel m) {
-	std::ofstream outfile;
-	outfile.open(filename);
+std::string outputMeta(const WofostModel &m, const std::string &crop, const std::string &weather, const std::string &soil) {
+	return "crop=" + crop + "\nweather=" + weather + "\nsoil=" + soil +
+		"\nmodelstart=" + std::to_string(m.control.modelstart) +
+		"\nlatitude=" + std::to_string(m.control.latitude) +
+		"\nelevation=" + std::to_string(m.control.elevation) +
+		"\nwater_limited=" + std::to_string(int(m.control.water_limited)) + "\n";
+}
+
+
+bool knownFormat(const std::string &format) {
+	return (format == "csv") || (format == "float64") || (format == "float32");
+}
+
+
+// run the model and write the output to file. Returns the number of rows
+// written, or -1 if the output file could not be written
+long runModel(WofostModel &m, const std::string &outputFile, const std::string &format, const std::string &meta, std::string *head) {
+	if (format != "csv") {
+		m.run();
+		if (!writeBinaryOutput(outputFile.c_str(), m.output, meta, format == "float32")) {
+			return -1;
+		}
+		return m.output.nrow;
+	}
+	// the rows are written while the model runs
+	CSVSink sink(outputFile.c_str());
+	if (!sink.ok()) {
+		return -1;
+	}
+	m.output.sink = &sink;
+	m.run();
+	m.output.sink = NULL;
+	if (head != NULL) *head = sink.head;
+	return sink.nrow;
+}
+
+
+/*
+Manifest mode: WOFOST jobs.csv [threads]
+The manifest has a header and one line per run. Required columns are
+crop, weather, soil, control and output (file names); optional columns are
+output_format, station and control overrides: modelstart (yyyy-mm-dd),
+cropstart, latitude, elevation, CO2, water_limited (true, false, 1 or 0)
+and variables (the output option; a list of names must be in double
+quotes, e.g. "LAI,WSO"). Each line must have as many cells as the header.
+A control file can only have one modelstart and CO2 (not a sweep). If there is a station, the weather file has the data of
+many stations (see StationWeather in weather.h); it is read once and each
+job gets the rows of its station.
+Each input file is read once and shared by all jobs that use it. The
+jobs run on a pool of threads; the time and messages of each job are
+written to jobs_log.csv
+*/
+
+class ManifestJob {
+public:
+	std::string crop, weather, soil, output, format;
+	const WofostCrop *crp;
+	const WofostSoil *sol;
+	const WofostWeather *wth;
+	const StationWeather *stations = NULL;
+	size_t station = 0;
+	WofostControl control;
+	// result
+	long nrow = 0;
+	double seconds = 0;
+	bool fatal = false;
+	std::string messages;
+};
+
+
+std::string trim(std::string s) {
+	size_t a = s.find_first_not_of(" \t\r");
+	if (a == std::string::npos) return "";
+	size_t b = s.find_last_not_of(" \t\r");
+	return s.substr(a, b-a+1);
+}
+
+
+bool setControl(WofostControl &tim, const std::string &name, const std::string &value) {
+	if (name == "modelstart") {
+		std::vector<std::string> ss = split(value, '-');
+		if (ss.size() != 3) throw std::invalid_argument(value);
+		tim.modelstart = daysFromCivil(std::stoi(ss[0]), std::stoi(ss[1]), std::stoi(ss[2]));
+	} else if (name == "cropstart") {
+		tim.cropstart = std::stoi(value);
+	} else if (name == "latitude") {
+		tim.latitude = std::stod(value);
+	} else if (name == "elevation") {
+		tim.elevation = std::stod(value);
+	} else if (name == "CO2") {
+		tim.CO2 = std::stod(value);
+	} else if (name == "water_limited") {
+		if (!stringToBool(value, tim.water_limited)) throw std::invalid_argument(value);
+	} else if (name == "variables") {
+		tim.output_option = value;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+
+void runJob(ManifestJob &job) {
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	WofostModel m;
+	m.crop = *job.crp;
+	m.soil = *job.sol;
+	m.control = job.control;
+	std::string weather = job.weather;
+	if (job.stations != NULL) {
+		job.stations->get(job.station, m.wth);
+		weather += "#" + job.stations->station[job.station];
+	} else {
+		m.wth = *job.wth;
+	}
+	job.nrow = runModel(m, job.output, job.format, outputMeta(m, job.crop, weather, job.soil), NULL);
+	job.fatal = m.fatalError;
+	for (size_t i=0; i<m.messages.size(); i++) {
+		if (i > 0) job.messages += "; ";
+		job.messages += m.messages[i];
+	}
+	if (job.nrow < 0) {
+		if (!job.messages.empty()) job.messages += "; ";
+		job.messages += "cannot write output file";
+	}
+	job.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+
+int runManifest(const std::string &manifest, unsigned nthreads) {
+	std::vector<std::vector<std::string> > rows = readCSV(manifest);
+	if (rows.size() < 2) {
+		std::cout << "no jobs in: " << manifest << std::endl;
+		return 1;
+	}
+	std::vector<std::string> cols = rows[0];
+	for (size_t j=0; j<cols.size(); j++) cols[j] = trim(cols[j]);
+	const char *required[] = {"crop", "weather", "soil", "control", "output"};
+	int reqcol[5];
+	for (size_t k=0; k<5; k++) {
+		reqcol[k] = std::find(cols.begin(), cols.end(), required[k]) - cols.begin();
+		if (reqcol[k] == int(cols.size())) {
+			std::cout << "manifest column missing: " << required[k] << std::endl;
+			return 1;
+		}
+	}
+	int fmtcol = std::find(cols.begin(), cols.end(), "output_format") - cols.begin();
+	int stacol = std::find(cols.begin(), cols.end(), "station") - cols.begin();
+
+	std::map<std::string, WofostCrop> crops;
+	std::map<std::string, WofostSoil> soils;
+	std::map<std::string, WofostWeather> weathers;
+	std::map<std::string, StationWeather> stations;
+	std::map<std::string, WofostControl> controls;
+
+	std::vector<ManifestJob> jobs(rows.size()-1);
+	for (size_t i=1; i<rows.size(); i++) {
+		std::vector<std::string> &r = rows[i];
+		if (r.size() != cols.size()) {
+			std::cout << "line " << i+1 << ": " << r.size() << " cells, the header has " << cols.size() << std::endl;
+			return 1;
+		}
+		for (size_t j=0; j<r.size(); j++) r[j] = trim(r[j]);
+		ManifestJob &job = jobs[i-1];
+		job.crop = r[reqcol[0]];
+		job.weather = r[reqcol[1]];
+		job.soil = r[reqcol[2]];
+		std::string control = r[reqcol[3]];
+		job.output = r[reqcol[4]];
+		job.format = (fmtcol < int(cols.size())) && !r[fmtcol].empty() ? r[fmtcol] : "csv";
+		if (!knownFormat(job.format)) {
+			std::cout << "line " << i+1 << ": unknown output_format: " << job.format << std::endl;
+			return 1;
+		}
+
+		if (crops.find(job.crop) == crops.end()) crops[job.crop] = getCropParameters(job.crop.c_str());
+		if (soils.find(job.soil) == soils.end()) soils[job.soil] = getSoilParameters(job.soil.c_str());
+		std::string station = stacol < int(cols.size()) ? r[stacol] : "";
+		if (!station.empty()) {
+			if (stations.find(job.weather) == stations.end()) {
+				std::string msg;
+				if (!readStationWeatherCSV(job.weather.c_str(), stations[job.weather], msg)) {
+					std::cout << msg << std::endl;
+					return 1;
+				}
+			}
+			job.stations = &stations[job.weather];
+			long k = job.stations->find(station);
+			if (k < 0) {
+				std::cout << "line " << i+1 << ": station " << station << " is not in " << job.weather << std::endl;
+				return 1;
+			}
+			job.station = k;
+		} else if (weathers.find(job.weather) == weathers.end()) {
+			weathers[job.weather] = getWeatherParameters(job.weather.c_str());
+		}
+		if (controls.find(control) == controls.end()) {
+			// a job is one run; a sweep would only run its first values
+			std::vector<long> starts;
+			std::vector<double> co2;
+			sweepValues(control.c_str(), starts, co2);
+			if (starts.size() * co2.size() > 1) {
+				std::cout << "line " << i+1 << ": " << control << " has more than one modelstart or CO2; use a line for each run" << std::endl;
+				return 1;
+			}
+			controls[control] = getControlParameters(control.c_str());
+		}
+		// std::map does not move its elements
+		job.crp = &crops[job.crop];
+		job.sol = &soils[job.soil];
+		job.wth = station.empty() ? &weathers[job.weather] : NULL;
+		job.control = controls[control];
+
+		for (size_t j=0; j<cols.size(); j++) {
+			if ((j == size_t(fmtcol)) || (j == size_t(stacol)) || r[j].empty() || (std::find(reqcol, reqcol+5, int(j)) != reqcol+5)) continue;
+			try {
+				if (!setControl(job.control, cols[j], r[j])) {
+					std::cout << "unknown manifest column: " << cols[j] << std::endl;
+					return 1;
+				}
+			} catch (...) {
+				std::cout << "line " << i+1 << ": invalid " << cols[j] << ": " << r[j] << std::endl;
+				return 1;
+			}
+		}
+		// the groundwater tables of a soil are made once, not in each job
+		WofostSoil &sol = soils[job.soil];
+		if (sol.p.IZT) sol.update_tables(job.control.subsol_table > 0);
+	}
+
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	nthreads = parallelFor(jobs.size(), nthreads, [&jobs](size_t i) { runJob(jobs[i]); });
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+	std::string logFile = manifest.substr(0, manifest.find_last_of('.')) + "_log.csv";
+	std::ofstream log(logFile.c_str());
+	log << "job,output,rows,seconds,fatal,messages\n";
+	size_t nfail = 0;
+	for (size_t i=0; i<jobs.size(); i++) {
+		ManifestJob &job = jobs[i];
+		if (job.fatal || (job.nrow < 0)) nfail++;
+		std::string msg = job.messages;
+		std::replace(msg.begin(), msg.end(), '"', '\'');
+		log << i+1 << "," << job.output << "," << job.nrow << "," << job.seconds << ","
+			<< int(job.fatal) << ",\"" << msg << "\"\n";
+	}
+	std::cout << jobs.size() << " jobs (" << nfail << " failed) in " << seconds << " seconds on "
+		<< nthreads << " threads" << std::endl;
+	std::cout << "log written to: " << logFile << std::endl;
+	return nfail > 0 ? 1 : 0;
+}
+
 
-	int nvar = m.output.names.size();
-	std::string outnames = m.output.names[0];
-	for(size_t i = 1; i < m.output.names.size(); i++){
-		outnames = outnames + ',' + m.output.names[i];
+/*
+Sweep: if modelstart in the control file is a list or range of dates
+and/or CO2 is a list of values, the model is run for each combination
+(on a pool of threads) with the same crop, soil and weather. All runs
+go to one output file, with a "run" column; the modelstart and CO2 of
+each run are written to <output>_runs.csv
+*/
+
+// the runs are done in blocks of 2 * nthreads. Each place in a block has
+// its own model (with a copy of the weather) that is used again in the
+// next blocks. After a block, done(i, model) is called for its runs, in
+// the order of the runs
+template <class F>
+void sweepBlocks(const WofostModel &base, const std::vector<long> &starts, const std::vector<double> &co2,
+		unsigned &nthreads, F done) {
+	size_t nrun = starts.size() * co2.size();
+	if (nthreads == 0) nthreads = std::max(1u, std::thread::hardware_concurrency());
+	nthreads = std::max(1u, std::min(nthreads, unsigned(nrun)));
+	std::vector<WofostModel> models(std::min(nrun, size_t(2) * nthreads), base);
+	for (size_t b=0; b<nrun; b+=models.size()) {
+		size_t n = std::min(models.size(), nrun - b);
+		parallelFor(n, nthreads, [&](size_t k) {
+			WofostModel &m = models[k];
+			m.messages.clear();
+			m.control.modelstart = starts[(b+k) / co2.size()];
+			m.control.CO2 = co2[(b+k) % co2.size()];
+			m.run();
+		});
+		for (size_t k=0; k<n; k++) done(b+k, models[k]);
 	}
-	outfile << outnames << std::endl;
+}
+
+
+class SweepRun {
+public:
+	long modelstart;
+	double CO2;
+	size_t nrow;
+	bool fatal;
+	std::string messages;
+};
+
+SweepRun sweepRun(const WofostModel &m) {
+	SweepRun r;
+	r.modelstart = m.control.modelstart;
+	r.CO2 = m.control.CO2;
+	r.nrow = m.output.nrow;
+	r.fatal = m.fatalError;
+	for (size_t k=0; k<m.messages.size(); k++) {
+		if (k > 0) r.messages += "; ";
+		r.messages += m.messages[k];
+	}
+	std::replace(r.messages.begin(), r.messages.end(), '"', '\'');
+	return r;
+}
 
-	size_t nrow = (m.output.values.size() / nvar);
-	std::cout << nrow << " rows written to: " << filename << std::endl;
-	std::cout << outnames << std::endl;
-    size_t k=0;
-	for (size_t i = 0; i < nrow; i++) {
-		std::string s = std::to_string(m.output.values[k]);
-		k++;
-		for (int j = 1; j < nvar; j++) {
-			s = s + ',' + std::to_string(m.output.values[k]);
-			k++;
+
+int runSweep(const WofostModel &base, const std::vector<long> &starts, const std::vector<double> &co2,
+		const std::vector<std::string> &files, unsigned nthreads) {
+
+	size_t nrun = starts.size() * co2.size();
+	std::vector<SweepRun> runs(nrun);
+	std::string outputFile = files[4];
+	std::string runsFile = outputFile.substr(0, outputFile.find_last_of('.')) + "_runs.csv";
+	size_t nrow = 0;
+
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	bool ok;
+	if (files[5] == "csv") {
+		// the rows are written in the order of the runs, after each block
+		CSVSink sink(outputFile.c_str());
+		ok = sink.ok();
+		if (ok) {
+			std::vector<std::string> names;
+			std::vector<double> row;
+			sweepBlocks(base, starts, co2, nthreads, [&](size_t i, WofostModel &m) {
+				runs[i] = sweepRun(m);
+				const WofostOutput &o = m.output;
+				if (names.empty() && (o.names.size() > 0)) {
+					names.push_back("run");
+					names.insert(names.end(), o.names.begin(), o.names.end());
+					sink.start(names);
+					row.resize(o.names.size());
+				}
+				if (!names.empty() && (o.names.size() == names.size()-1) && (o.values.size() >= o.names.size() * o.nrow)) {
+					for (size_t k=0; k<o.nrow; k++) {
+						for (size_t j=0; j<row.size(); j++) row[j] = o.values[j*o.nrow+k];
+						sink.row(long(i+1), row.data(), row.size());
+					}
+					nrow += o.nrow;
+				}
+			});
+			if (names.empty()) sink.start(std::vector<std::string>(1, "run"));
+			sink.finish();
 		}
-		outfile << s << std::endl;
-		if (i < 5)	std::cout << s << std::endl;
+	} else {
+		// the columns of all runs are needed before the file can be written
+		std::vector<WofostOutput> outs(nrun);
+		sweepBlocks(base, starts, co2, nthreads, [&](size_t i, WofostModel &m) {
+			runs[i] = sweepRun(m);
+			const WofostOutput &o = m.output;
+			outs[i].names = o.names;
+			outs[i].nrow = o.nrow;
+			size_t n = std::min(o.values.size(), o.names.size() * o.nrow);
+			outs[i].values.assign(o.values.begin(), o.values.begin() + n);
+			nrow += o.nrow;
+		});
+		std::string meta = "crop=" + files[0] + "\nweather=" + files[1] + "\nsoil=" + files[2] + "\nruns=" + runsFile + "\n";
+		ok = writeBinaryRuns(outputFile.c_str(), outs, meta, files[5] == "float32");
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	if (!ok) {
+		std::cout << "cannot write output file: " << outputFile << std::endl;
+		return 1;
+	}
+
+	std::ofstream rf(runsFile.c_str());
+	rf << "run,modelstart,CO2,rows,fatal,messages\n";
+	for (size_t i=0; i<nrun; i++) {
+		const SweepRun &r = runs[i];
+		rf << i+1 << "," << civilFromDays(r.modelstart) << "," << r.CO2 << ","
+			<< r.nrow << "," << int(r.fatal) << ",\"" << r.messages << "\"\n";
 	}
-	outfile.close();
+	std::cout << nrun << " runs in " << seconds << " seconds on " << nthreads << " threads" << std::endl;
+	std::cout << nrow << " rows written to: " << outputFile << std::endl;
+	std::cout << "runs written to: " << runsFile << std::endl;
+	return 0;
 }
 
+
 int main(int argc, char *argv[]) {
 
     char *inputFile;
@@ -221,12 +604,22 @@ int main(int argc, char *argv[]) {
     } else {
         inputFile = argv[1];
     }
+	unsigned nthreads = argc > 2 ? std::stoi(argv[2]) : 0;
+	if (getFileExtension(inputFile) == ".csv") {
+		return runManifest(inputFile, nthreads);
+	}
+
 	std::vector<std::string> files = getFiles(inputFile);
 	const char *cropFile = files[0].c_str();
 	const char *weatherFile = files[1].c_str();
 	const char *soilFile = files[2].c_str();
 	const char *controlFile = files[3].c_str();
-	const char *outputFile = files[4].c_str();
+	std::string outputFile = files[4];
+	std::string outputFormat = files[5];
+	if (!knownFormat(outputFormat)) {
+		std::cout << "unknown output_format: " << outputFormat << std::endl;
+		return 1;
+	}
 
 	WofostCrop crp = getCropParameters(cropFile);
 	WofostSoil sol = getSoilParameters(soilFile);
@@ -239,15 +632,29 @@ int main(int argc, char *argv[]) {
 	m.crop = crp;
 	m.soil = sol;
 	m.control = tim;
-    //int start = date2int(date(1977, 1, 1));
+    //int start = daysFromCivil(1977, 1, 1);
 	//m.control.modelstart = start;
 	m.wth = wth;
 //    m.wth$latitude <- 52.57
-	m.model_run();
+
+	std::vector<long> starts;
+	std::vector<double> co2;
+	sweepValues(controlFile, starts, co2);
+	if (starts.size() * co2.size() > 1) {
+		return runSweep(m, starts, co2, files, nthreads);
+	}
+
+	std::string head;
+	long nrow = runModel(m, outputFile, outputFormat, outputMeta(m, files[0], files[1], files[2]), &head);
     for (size_t i=0; i<m.messages.size(); i++) {
        std::cout << m.messages[i] << std::endl;
     }
-	writeOutput(outputFile, m);
+	if (nrow < 0) {
+		std::cout << "cannot write output file: " << outputFile << std::endl;
+		return 1;
+	}
+	std::cout << nrow << " rows written to: " << outputFile << std::endl;
+	std::cout << head;
 
 	return 0;
 }
@@ -0,0 +1,95 @@
+/*
+Robert Hijmans
+2026
+
+License: GNU General Public License (GNU GPL) v. 2
+*/
+
+#include <cstdio>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "mapfile.h"
+
+
+// read the file into buf
+static bool read_file(const char *filename, std::vector<char> &buf) {
+	FILE *f = fopen(filename, "rb");
+	if (f == NULL) return false;
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	buf.resize(size > 0 ? size : 0);
+	size_t n = fread(buf.data(), 1, buf.size(), f);
+	fclose(f);
+	return n == buf.size();
+}
+
+
+bool MappedFile::open(const char *filename) {
+	close();
+#ifdef _WIN32
+	HANDLE f = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (f == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER n;
+	if (GetFileSizeEx(f, &n) && (n.QuadPart > 0)) {
+		HANDLE m = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (m != NULL) {
+			void *p = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+			if (p != NULL) {
+				hfile = f;
+				hmap = m;
+				data = (const char*) p;
+				size = n.QuadPart;
+				mapped = true;
+				return true;
+			}
+			CloseHandle(m);
+		}
+	}
+	CloseHandle(f);
+#else
+	int fd = ::open(filename, O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if ((fstat(fd, &st) == 0) && (st.st_size > 0)) {
+		void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED) {
+			::close(fd);
+			madvise(p, st.st_size, MADV_SEQUENTIAL);
+			data = (const char*) p;
+			size = st.st_size;
+			mapped = true;
+			return true;
+		}
+	}
+	::close(fd);
+#endif
+	// empty files, or files that cannot be mapped
+	if (!read_file(filename, buf)) return false;
+	data = buf.data();
+	size = buf.size();
+	return true;
+}
+
+
+void MappedFile::close() {
+	if (mapped) {
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+		CloseHandle(hmap);
+		CloseHandle(hfile);
+#else
+		munmap((void*) data, size);
+#endif
+		mapped = false;
+	}
+	std::vector<char>().swap(buf);
+	data = NULL;
+	size = 0;
+}
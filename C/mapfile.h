@@ -0,0 +1,35 @@
+/*
+Robert Hijmans
+2026
+
+License: GNU General Public License (GNU GPL) v. 2
+*/
+
+#ifndef MAPFILE_H_
+#define MAPFILE_H_
+
+#include <cstddef>
+#include <vector>
+
+// a read-only view of a file. The file is memory-mapped (mmap, or
+// MapViewOfFile on Windows) so that it is read from the page cache
+// without copying; if that is not possible, it is read into memory
+class MappedFile {
+public:
+	MappedFile() {}
+	~MappedFile() { close(); }
+	bool open(const char *filename);
+	void close();
+	const char *data = NULL;
+	size_t size = 0;
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+	bool mapped = false;
+	std::vector<char> buf;
+#ifdef _WIN32
+	void *hfile = NULL, *hmap = NULL;
+#endif
+};
+
+#endif
@@ -0,0 +1,392 @@
+/*
+Robert Hijmans
+2026
+
+License: GNU General Public License (GNU GPL) v. 2
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <unordered_set>
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
+#include "weather.h"
+#include "mapfile.h"
+#include <sys/stat.h>
+
+
+// H. Hinnant, http://howardhinnant.github.io/date_algorithms.html
+long daysFromCivil(int y, int m, int d) {
+	y -= m <= 2;
+	long era = (y >= 0 ? y : y-399) / 400;
+	long yoe = y - era * 400;
+	long doy = (153 * (m > 2 ? m-3 : m+9) + 2) / 5 + d - 1;
+	long doe = yoe * 365 + yoe/4 - yoe/100 + doy;
+	return era * 146097 + doe - 719468;
+}
+
+
+std::string civilFromDays(long z) {
+	z += 719468;
+	long era = (z >= 0 ? z : z - 146096) / 146097;
+	long doe = z - era * 146097;
+	long yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+	long doy = doe - (365*yoe + yoe/4 - yoe/100);
+	long mp = (5*doy + 2)/153;
+	long d = doy - (153*mp+2)/5 + 1;
+	long m = mp < 10 ? mp+3 : mp-9;
+	long y = yoe + era * 400 + (m <= 2);
+	char s[32];
+	snprintf(s, sizeof(s), "%04d-%02d-%02d", int(y), int(m), int(d));
+	return s;
+}
+
+
+// the cell between p and e without surrounding spaces and quotes
+static void trim(const char* &p, const char* &e) {
+	while ((p < e) && ((*p == ' ') || (*p == '"'))) p++;
+	while ((e > p) && ((e[-1] == ' ') || (e[-1] == '"') || (e[-1] == '\r'))) e--;
+}
+
+
+static bool parse_int(const char* &p, const char *e, int &x) {
+	if ((p == e) || (*p < '0') || (*p > '9')) return false;
+	x = 0;
+	while ((p < e) && (*p >= '0') && (*p <= '9')) {
+		x = x * 10 + (*p - '0');
+		p++;
+	}
+	return true;
+}
+
+
+static bool parse_date(const char *p, const char *e, long &x) {
+	trim(p, e);
+	int y, m, d;
+	if (!parse_int(p, e, y) || (p == e) || (*p++ != '-')) return false;
+	if (!parse_int(p, e, m) || (p == e) || (*p++ != '-')) return false;
+	if (!parse_int(p, e, d) || (p != e)) return false;
+	if ((m < 1) || (m > 12) || (d < 1) || (d > 31)) return false;
+	x = daysFromCivil(y, m, d);
+	return true;
+}
+
+
+static bool parse_number(const char *p, const char *e, double &x) {
+	trim(p, e);
+	if ((p == e) || ((e - p == 2) && (p[0] == 'N') && (p[1] == 'A'))) {
+		x = NAN;
+		return true;
+	}
+	if (*p == '+') p++;
+#ifdef __cpp_lib_to_chars
+	std::from_chars_result r = std::from_chars(p, e, x);
+	return (r.ec == std::errc()) && (r.ptr == e);
+#else
+	char s[64];
+	size_t n = e - p;
+	if (n >= sizeof(s)) return false;
+	memcpy(s, p, n);
+	s[n] = '\0';
+	char *end;
+	x = strtod(s, &end);
+	return end == s + n;
+#endif
+}
+
+
+// if there is a station column, the station ids and the first row of each
+// station are added to ids and first (if these are not NULL)
+static bool parse_weather(const char *begin, const char *end, WofostWeather &wth, std::vector<std::string> *ids, std::vector<size_t> *first, std::string &msg) {
+	const char *p = begin;
+	const char *eol = std::find(p, end, '\n');
+
+	// the columns that are read, in the order of the file
+	const char *names[] = {"date", "srad", "tmin", "tmax", "vapr", "wind", "prec", "station"};
+	std::vector<double> *vars[] = {NULL, &wth.srad, &wth.tmin, &wth.tmax, &wth.vapr, &wth.wind, &wth.prec};
+	std::vector<int> cols;
+	const char *e = p - 1;
+	while (e < eol) {
+		p = e + 1;
+		e = std::find(p, eol, ',');
+		const char *a = p, *b = e;
+		trim(a, b);
+		int k = -1;
+		for (int i=0; i<8; i++) {
+			if ((size_t(b - a) == strlen(names[i])) && (strncmp(a, names[i], b - a) == 0)) k = i;
+		}
+		cols.push_back(k);
+	}
+	int nfound = 0;
+	for (int i=0; i<7; i++) {
+		nfound += std::find(cols.begin(), cols.end(), i) != cols.end();
+	}
+	if (nfound < 7) {
+		if (cols.size() < 7) {
+			msg = "weather file has less than 7 columns";
+			return false;
+		}
+		for (size_t j=0; j<cols.size(); j++) cols[j] = j < 7 ? j : -1;
+	}
+
+	size_t n = std::count(eol, end, '\n') + 1;
+	wth.date.clear(); wth.date.reserve(n);
+	for (int i=1; i<7; i++) {
+		vars[i]->clear();
+		vars[i]->reserve(n);
+	}
+
+	std::vector<std::string> stations;
+	std::unordered_set<std::string> seen;
+	std::string id;
+	size_t line = 1;
+	p = eol;
+	while (p < end) {
+		p++;
+		line++;
+		eol = std::find(p, end, '\n');
+		if ((p == eol) || ((eol - p == 1) && (*p == '\r'))) {
+			p = eol;
+			continue;
+		}
+		size_t ncell = 0;
+		e = p - 1;
+		for (size_t j=0; (j<cols.size()) && (e < eol); j++) {
+			p = e + 1;
+			e = std::find(p, eol, ',');
+			int k = cols[j];
+			if (k == 0) {
+				long d;
+				if (!parse_date(p, e, d)) {
+					msg = "invalid date on line " + std::to_string(line);
+					return false;
+				}
+				wth.date.push_back(d);
+				ncell++;
+			} else if ((k > 0) && (k < 7)) {
+				double x;
+				if (!parse_number(p, e, x)) {
+					msg = "invalid " + std::string(names[k]) + " on line " + std::to_string(line);
+					return false;
+				}
+				vars[k]->push_back(x);
+				ncell++;
+			} else if (k == 7) {
+				const char *a = p, *b = e;
+				trim(a, b);
+				if (stations.empty() || (size_t(b - a) != id.size()) || (id.compare(0, id.size(), a, b - a) != 0)) {
+					id.assign(a, b);
+					if (!seen.insert(id).second) {
+						msg = "weather file is not sorted by station (line " + std::to_string(line) + ")";
+						return false;
+					}
+					stations.push_back(id);
+					if (first != NULL) first->push_back(wth.date.size());
+				}
+			}
+		}
+		if (ncell != 7) {
+			msg = "missing values on line " + std::to_string(line);
+			return false;
+		}
+		p = eol;
+	}
+	if (ids != NULL) {
+		ids->swap(stations);
+		if (first != NULL) first->push_back(wth.date.size());
+	} else if (stations.size() > 1) {
+		msg = "weather file has more than one station";
+		return false;
+	}
+	return true;
+}
+
+
+bool parseWeatherCSV(const char *begin, const char *end, WofostWeather &wth, std::string &msg) {
+	return parse_weather(begin, end, wth, NULL, NULL, msg);
+}
+
+
+bool readWeatherCSV(const char *filename, WofostWeather &wth, std::string &msg) {
+	MappedFile f;
+	if (!f.open(filename)) {
+		msg = std::string(filename) + " not found";
+		return false;
+	}
+	return parseWeatherCSV(f.data, f.data + f.size, wth, msg);
+}
+
+
+static const char cache_magic[8] = {'W', 'O', 'F', 'O', 'S', 'T', 'W', 0};
+static const size_t cache_header = 32;
+
+
+bool writeWeatherCache(const char *filename, const WofostWeather &wth, std::string &msg) {
+	size_t n = wth.date.size();
+	const std::vector<double> *vars[] = {&wth.srad, &wth.tmin, &wth.tmax, &wth.vapr, &wth.wind, &wth.prec};
+	for (int i=0; i<6; i++) {
+		if (vars[i]->size() != n) {
+			msg = "weather variables have different lengths";
+			return false;
+		}
+	}
+	uint32_t nogaps = 1;
+	for (size_t i=1; i<n; i++) {
+		if (wth.date[i] != wth.date[i-1] + 1) {
+			nogaps = 0;
+			break;
+		}
+	}
+	char h[cache_header];
+	uint32_t version = 1;
+	int64_t first = n > 0 ? wth.date[0] : 0;
+	uint64_t nn = n;
+	memcpy(h, cache_magic, 8);
+	memcpy(h+8, &version, 4);
+	memcpy(h+12, &nogaps, 4);
+	memcpy(h+16, &first, 8);
+	memcpy(h+24, &nn, 8);
+
+	FILE *f = fopen(filename, "wb");
+	if (f == NULL) {
+		msg = std::string("cannot write ") + filename;
+		return false;
+	}
+	bool ok = fwrite(h, 1, cache_header, f) == cache_header;
+	if (!nogaps) {
+		std::vector<int64_t> d(wth.date.begin(), wth.date.end());
+		ok = ok && (fwrite(d.data(), sizeof(int64_t), n, f) == n);
+	}
+	for (int i=0; i<6; i++) {
+		ok = ok && (fwrite(vars[i]->data(), sizeof(double), n, f) == n);
+	}
+	ok = (fclose(f) == 0) && ok;
+	if (!ok) msg = std::string("cannot write ") + filename;
+	return ok;
+}
+
+
+static bool is_cache(const MappedFile &f) {
+	return (f.size >= cache_header) && (memcmp(f.data, cache_magic, 8) == 0);
+}
+
+
+static bool read_cache(const MappedFile &f, WofostWeather &wth, std::string &msg) {
+	uint32_t version, nogaps;
+	int64_t first;
+	uint64_t n;
+	memcpy(&version, f.data+8, 4);
+	memcpy(&nogaps, f.data+12, 4);
+	memcpy(&first, f.data+16, 8);
+	memcpy(&n, f.data+24, 8);
+	if (version != 1) {
+		msg = "unknown weather cache version";
+		return false;
+	}
+	if (f.size != cache_header + (nogaps ? 6 : 7) * n * 8) {
+		msg = "weather cache has the wrong size";
+		return false;
+	}
+	// the file is mapped at a page boundary, so the columns are aligned
+	const char *p = f.data + cache_header;
+	if (nogaps) {
+		wth.date.resize(n);
+		for (size_t i=0; i<n; i++) wth.date[i] = first + i;
+	} else {
+		const int64_t *d = (const int64_t*) p;
+		wth.date.assign(d, d + n);
+		p += n * 8;
+	}
+	std::vector<double> *vars[] = {&wth.srad, &wth.tmin, &wth.tmax, &wth.vapr, &wth.wind, &wth.prec};
+	for (int i=0; i<6; i++) {
+		const double *v = (const double*) p;
+		vars[i]->assign(v, v + n);
+		p += n * 8;
+	}
+	return true;
+}
+
+
+bool readWeatherCache(const char *filename, WofostWeather &wth, std::string &msg) {
+	MappedFile f;
+	if (!f.open(filename)) {
+		msg = std::string(filename) + " not found";
+		return false;
+	}
+	if (!is_cache(f)) {
+		msg = std::string(filename) + " is not a weather cache";
+		return false;
+	}
+	return read_cache(f, wth, msg);
+}
+
+
+std::string weatherCacheName(const std::string &filename) {
+	return filename + ".cache";
+}
+
+
+bool readWeather(const char *filename, WofostWeather &wth, std::string &msg) {
+	std::string cache = weatherCacheName(filename);
+	struct stat sc, sf;
+	if ((stat(cache.c_str(), &sc) == 0) && (stat(filename, &sf) == 0) && (sc.st_mtime >= sf.st_mtime)) {
+		if (readWeatherCache(cache.c_str(), wth, msg)) return true;
+		msg.clear();
+	}
+	MappedFile f;
+	if (!f.open(filename)) {
+		msg = std::string(filename) + " not found";
+		return false;
+	}
+	if (is_cache(f)) {
+		return read_cache(f, wth, msg);
+	}
+	return parseWeatherCSV(f.data, f.data + f.size, wth, msg);
+}
+
+
+void StationWeather::get(size_t i, WofostWeather &w) const {
+	size_t a = first[i], b = first[i+1];
+	w.date.assign(wth.date.begin() + a, wth.date.begin() + b);
+	w.srad.assign(wth.srad.begin() + a, wth.srad.begin() + b);
+	w.tmin.assign(wth.tmin.begin() + a, wth.tmin.begin() + b);
+	w.tmax.assign(wth.tmax.begin() + a, wth.tmax.begin() + b);
+	w.vapr.assign(wth.vapr.begin() + a, wth.vapr.begin() + b);
+	w.wind.assign(wth.wind.begin() + a, wth.wind.begin() + b);
+	w.prec.assign(wth.prec.begin() + a, wth.prec.begin() + b);
+}
+
+
+long StationWeather::find(const std::string &id) const {
+	std::unordered_map<std::string, size_t>::const_iterator i = index.find(id);
+	return i == index.end() ? -1 : long(i->second);
+}
+
+
+bool readStationWeatherCSV(const char *filename, StationWeather &sw, std::string &msg) {
+	MappedFile f;
+	if (!f.open(filename)) {
+		msg = std::string(filename) + " not found";
+		return false;
+	}
+	sw.station.clear();
+	sw.first.clear();
+	sw.index.clear();
+	if (!parse_weather(f.data, f.data + f.size, sw.wth, &sw.station, &sw.first, msg)) {
+		return false;
+	}
+	if (sw.station.empty()) {
+		msg = std::string(filename) + " has no station column";
+		return false;
+	}
+	for (size_t i=0; i<sw.station.size(); i++) {
+		sw.index[sw.station[i]] = i;
+	}
+	return true;
+}
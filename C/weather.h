@@ -0,0 +1,74 @@
+/*
+Robert Hijmans
+2026
+
+License: GNU General Public License (GNU GPL) v. 2
+*/
+
+#ifndef WEATHER_H_
+#define WEATHER_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "wofost.h"
+
+// days since 1970-01-01
+long daysFromCivil(int y, int m, int d);
+// yyyy-mm-dd for days since 1970-01-01
+std::string civilFromDays(long z);
+
+/*
+Read a weather csv file with a header and columns date (yyyy-mm-dd),
+srad, tmin, tmax, vapr, wind and prec. The columns are matched by name
+(quoted or not), or taken in this order if the header does not have
+these names. Empty and NA cells are read as NAN. The file is mapped into
+memory and parsed in place, without making strings for the cells.
+Returns false and sets msg if the file cannot be read or parsed.
+*/
+bool readWeatherCSV(const char *filename, WofostWeather &wth, std::string &msg);
+bool parseWeatherCSV(const char *begin, const char *end, WofostWeather &wth, std::string &msg);
+
+/*
+A weather file with the data of several stations, with an additional
+"station" column (the station id). The rows must be sorted by station
+(and by date within a station). The file is read in one pass, and the
+first row of each station is recorded.
+*/
+class StationWeather {
+public:
+	std::vector<std::string> station;
+	std::unordered_map<std::string, size_t> index;
+	// the first row of each station, and the number of rows
+	std::vector<size_t> first;
+	// the data of all stations
+	WofostWeather wth;
+	// the index of a station, or -1
+	long find(const std::string &id) const;
+	// copy the weather of station i
+	void get(size_t i, WofostWeather &w) const;
+};
+
+bool readStationWeatherCSV(const char *filename, StationWeather &sw, std::string &msg);
+
+/*
+Binary weather cache, written by wofost-convert (little-endian):
+	char[8]  "WOFOSTW\0"
+	uint32   format version (1)
+	uint32   1 if the dates are consecutive days, 0 if there are gaps
+	int64    the first date (days since 1970-01-01)
+	uint64   number of days (n)
+	int64[n] the dates, only if there are gaps
+	float64[n] srad, tmin, tmax, vapr, wind and prec, one column after the other
+*/
+bool writeWeatherCache(const char *filename, const WofostWeather &wth, std::string &msg);
+bool readWeatherCache(const char *filename, WofostWeather &wth, std::string &msg);
+
+// the name of the cache for a weather file
+std::string weatherCacheName(const std::string &filename);
+
+// read a weather cache or csv file. For a csv file, the cache next to it
+// is used instead if it exists and is not older than the csv file
+bool readWeather(const char *filename, WofostWeather &wth, std::string &msg);
+
+#endif
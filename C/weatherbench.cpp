@@ -0,0 +1,87 @@
+/*
+Robert Hijmans
+2026
+
+License: GNU General Public License (GNU GPL) v. 2
+
+Compares the time to read a weather file with readCSV (a string for each
+cell, as the CLI did before) and with readWeatherCSV, and checks that
+both give the same values.
+
+g++ -std=c++17 -O2 -I ../src/ date.cpp files.cpp mapfile.cpp weather.cpp weatherbench.cpp -o weatherbench
+./weatherbench input/Netherlands_Swifterbant.csv [repeats]
+*/
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "files.h"
+#include "weather.h"
+
+
+static WofostWeather readStrings(const char *filename) {
+	std::vector< std::vector<std::string> > matrix = readCSV(filename);
+	WofostWeather wth;
+	date start(1970, 1, 1);
+	std::vector<std::string> ss;
+	for (size_t i = 1; i < matrix.size(); i++) {
+		ss = split(matrix[i][0], '-');
+		date d(std::stoi(ss[0]), std::stoi(ss[1]), std::stoi(ss[2]));
+		wth.date.push_back(d - start);
+		wth.srad.push_back( std::stod(matrix[i][1]) );
+		wth.tmin.push_back( std::stod(matrix[i][2]) );
+		wth.tmax.push_back( std::stod(matrix[i][3]) );
+		wth.vapr.push_back( std::stod(matrix[i][4]) );
+		wth.wind.push_back( std::stod(matrix[i][5]) );
+		wth.prec.push_back( std::stod(matrix[i][6]) );
+	}
+	return wth;
+}
+
+
+static bool same(const std::vector<double> &a, const std::vector<double> &b) {
+	if (a.size() != b.size()) return false;
+	for (size_t i=0; i<a.size(); i++) {
+		if ((a[i] != b[i]) && !(std::isnan(a[i]) && std::isnan(b[i]))) return false;
+	}
+	return true;
+}
+
+
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		std::cout << "Usage: weatherbench weather.csv [repeats]" << std::endl;
+		return 1;
+	}
+	const char *filename = argv[1];
+	int repeats = argc > 2 ? std::stoi(argv[2]) : 20;
+
+	typedef std::chrono::steady_clock clock;
+	WofostWeather a, b;
+	clock::time_point t0 = clock::now();
+	for (int i=0; i<repeats; i++) {
+		a = readStrings(filename);
+	}
+	clock::time_point t1 = clock::now();
+	std::string msg;
+	for (int i=0; i<repeats; i++) {
+		if (!readWeatherCSV(filename, b, msg)) {
+			std::cout << msg << std::endl;
+			return 1;
+		}
+	}
+	clock::time_point t2 = clock::now();
+
+	double ta = std::chrono::duration<double, std::milli>(t1 - t0).count() / repeats;
+	double tb = std::chrono::duration<double, std::milli>(t2 - t1).count() / repeats;
+	bool ok = (a.date == b.date) && same(a.srad, b.srad) && same(a.tmin, b.tmin) && same(a.tmax, b.tmax)
+		&& same(a.vapr, b.vapr) && same(a.wind, b.wind) && same(a.prec, b.prec);
+
+	std::cout << b.date.size() << " days" << std::endl;
+	std::cout << "readCSV:        " << ta << " ms" << std::endl;
+	std::cout << "readWeatherCSV: " << tb << " ms (" << ta / tb << " times faster)" << std::endl;
+	std::cout << (ok ? "same values" : "DIFFERENT VALUES") << std::endl;
+	return ok ? 0 : 1;
+}
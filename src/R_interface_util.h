@@ -13,6 +13,7 @@ License: GNU General Public License (GNU GPL) v. 3
 using namespace Rcpp;
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 template <class T>
 T valueFromList(List lst, const char*s) {
@@ -76,5 +77,62 @@ std::vector<double> TableFromList(List lst, const char* s){
 	return result;
 }
 
+
+// the elements of a named list, looked up with a hash index of the names.
+// The names of missing required elements are collected, so that they can
+// all be reported at once (with check)
+class NamedList {
+public:
+	NamedList(List x) : lst(x) {
+		SEXP n = Rf_getAttrib(lst, R_NamesSymbol);
+		if (Rf_isNull(n)) return;
+		CharacterVector nms(n);
+		for (R_xlen_t i=0; i<nms.size(); i++) {
+			index.emplace(std::string(nms[i]), i);
+		}
+	}
+	List lst;
+	std::unordered_map<std::string, R_xlen_t> index;
+	std::vector<std::string> missing;
+
+	SEXP find(const char *s) {
+		std::unordered_map<std::string, R_xlen_t>::const_iterator i = index.find(s);
+		return i == index.end() ? R_NilValue : (SEXP) lst[i->second];
+	}
+	// required element
+	template <class T> void get(const char *s, T &x) {
+		SEXP v = find(s);
+		if (v == R_NilValue) {
+			missing.push_back(s);
+		} else {
+			x = as<T>(v);
+		}
+	}
+	// x is not changed if there is no such element
+	template <class T> void optional(const char *s, T &x) {
+		SEXP v = find(s);
+		if (v != R_NilValue) x = as<T>(v);
+	}
+	// a table: a matrix with two rows (x and y), or a vector of x, y pairs
+	void table(const char *s, std::vector<double> &x) {
+		SEXP v = find(s);
+		if (v == R_NilValue) {
+			missing.push_back(s);
+			return;
+		}
+		NumericVector t(v);
+		if (Rf_isMatrix(v) ? (Rf_nrows(v) != 2) : (t.size() % 2 != 0)) {
+			stop("parameter '" + std::string(s) + "' is not a table with x and y values");
+		}
+		x.assign(t.begin(), t.end());
+	}
+	void check(const char *what) {
+		if (missing.empty()) return;
+		std::string m = std::string(what) + " parameters missing: " + missing[0];
+		for (size_t i=1; i<missing.size(); i++) m += ", " + missing[i];
+		stop(m);
+	}
+};
+
 #endif
 
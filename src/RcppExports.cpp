@@ -11,7 +11,7 @@ Rcpp::Rostream<false>& Rcpp::Rcerr = Rcpp::Rcpp_cerr_get();
 #endif
 
 // wofost
-NumericMatrix wofost(List crop, DataFrame weather, List soil, List control);
+List wofost(List crop, DataFrame weather, List soil, List control);
 RcppExport SEXP _Rwofost_wofost(SEXP cropSEXP, SEXP weatherSEXP, SEXP soilSEXP, SEXP controlSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
@@ -24,11 +24,27 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// wofost_sites
+List wofost_sites(List crops, List weather, List soils, List control, int threads);
+RcppExport SEXP _Rwofost_wofost_sites(SEXP cropsSEXP, SEXP weatherSEXP, SEXP soilsSEXP, SEXP controlSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type crops(cropsSEXP);
+    Rcpp::traits::input_parameter< List >::type weather(weatherSEXP);
+    Rcpp::traits::input_parameter< List >::type soils(soilsSEXP);
+    Rcpp::traits::input_parameter< List >::type control(controlSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(wofost_sites(crops, weather, soils, control, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
 
 RcppExport SEXP _rcpp_module_boot_wofost();
 
 static const R_CallMethodDef CallEntries[] = {
     {"_Rwofost_wofost", (DL_FUNC) &_Rwofost_wofost, 4},
+    {"_Rwofost_wofost_sites", (DL_FUNC) &_Rwofost_wofost_sites, 5},
     {"_rcpp_module_boot_wofost", (DL_FUNC) &_rcpp_module_boot_wofost, 0},
     {NULL, NULL, 0}
 };
@@ -39,6 +39,13 @@ RCPP_EXPOSED_CLASS(WofostForcer)
 
 RCPP_EXPOSED_CLASS(WofostSoilCollection)
 
+// in wofost_R_interface.cpp
+Rcpp::List outputDF(WofostModel* m);
+void setCrop(WofostModel* m, Rcpp::List crop);
+void setSoil(WofostModel* m, Rcpp::List soil);
+void setControl(WofostModel* m, Rcpp::List control);
+void setSoilParameters(WofostSoil* s, Rcpp::List soil);
+
 
 
 RCPP_MODULE(wofost){
@@ -67,6 +74,7 @@ RCPP_MODULE(wofost){
 		.field("ANGSTB",  &WofostControl::ANGSTB) 
 		//.field("usePENMAN",  &WofostControl::usePENMAN) 
 		.field("useForce",  &WofostControl::useForce) 
+		.field("subsol_table",  &WofostControl::subsol_table) 
 	;
 
 	
@@ -190,6 +198,7 @@ RCPP_MODULE(wofost){
     class_<WofostSoil>("WofostSoil")
 		.constructor()
 		.field("p", &WofostSoil::p, "soil parameters")
+		.method("set", &setSoilParameters, "set all soil parameters from a list")
 		//.field("pn", &WofostSoil::pn, "soil nutrient parameters")
 	;
 
@@ -241,6 +250,12 @@ RCPP_MODULE(wofost){
 		.constructor()
 		.method("run", &WofostModel::run, "run the model")		
 		.method("run_batch", &WofostModel::run_batch, "run the model")		
+		// not exported until validated on the PCSE cases (tests/precision_tests.R)
+		//.method("run_batch_float", &WofostModel::run_batch_float, "run the model in single precision")
+		.method("output_frame", &outputDF, "the output as a data.frame")
+		.method("set_crop", &setCrop, "set all crop parameters from a list")
+		.method("set_soil", &setSoil, "set all soil parameters from a list")
+		.method("set_control", &setControl, "set control parameters from a list")
 
 		//.method("setWeather", &setWeather)
 		.field("crop", &WofostModel::crop, "crop")
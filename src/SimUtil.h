@@ -8,6 +8,9 @@
 
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <thread>
+#include <atomic>
 
 
 template <class T> T minvalue(std::vector<T> v) {
@@ -51,7 +54,7 @@ inline void clampinplace(double minv, double maxv, double &v) {
   v = v < minv ? minv : (v > maxv ? maxv : v);
 }
 
-inline double AFGEN(std::vector<double> xy, double x) {
+inline double AFGEN(const std::vector<double> &xy, double x) {
 	int n = xy.size();
 	double y = -99;
 	if (x <= xy[0]) {
@@ -71,6 +74,47 @@ inline double AFGEN(std::vector<double> xy, double x) {
 }
 
 
+// AFGEN for a table with x = 0, 2, 4, 8, ..., 2^k (SDEFTB);
+// the interval is found from the binary exponent of x
+inline double AFGENLOG2(const std::vector<double> &xy, double x) {
+	int n = xy.size();
+	if (x <= xy[0]) {
+		return xy[1];
+	} else if (!(x < xy[n-2])) {
+		return xy[n-1];
+	}
+	int e;
+	std::frexp(x, &e);
+	int i = 2 * std::max(e, 1);
+	double slope = (xy[i+1] - xy[i-1]) / (xy[i] - xy[i-2]);
+	return xy[i-1] + (x - xy[i-2]) * slope;
+}
+
+
+// AFGEN with a binary search for the interval; for longer tables (DEFDTB)
+inline double AFGENBIN(const std::vector<double> &xy, double x) {
+	int n = xy.size();
+	if (x <= xy[0]) {
+		return xy[1];
+	} else if (x >= xy[n-2]) {
+		return xy[n-1];
+	}
+	// first node with xy[2*i] > x
+	int lo = 1, hi = n/2 - 1;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (xy[2*mid] > x) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+	int i = 2 * lo;
+	double slope = (xy[i+1] - xy[i-1]) / (xy[i] - xy[i-2]);
+	return xy[i-1] + (x - xy[i-2]) * slope;
+}
+
+
 inline double AFGEN2(const std::vector<double> &xy, const double &x) {
 	size_t n = xy.size();
 	size_t hn = n / 2;
@@ -190,4 +234,34 @@ inline unsigned doy_from_days(long z) {
 
 
 
+// index of the first date that is not before d (the dates are sorted).
+// Computed from the first date if the dates are consecutive days
+inline size_t date_index(const std::vector<long> &date, long d) {
+	size_t n = date.size();
+	if ((n > 0) && (date[n-1] - date[0] == long(n-1)) && (d >= date[0]) && (d <= date[n-1])) {
+		return d - date[0];
+	}
+	return std::lower_bound(date.begin(), date.end(), d) - date.begin();
+}
+
+
+// run f(0), ..., f(n-1) on a pool of threads that each take the next i
+template <class F> unsigned parallelFor(size_t n, unsigned nthreads, F f) {
+	if (nthreads == 0) nthreads = std::max(1u, std::thread::hardware_concurrency());
+	nthreads = std::max(1u, std::min(nthreads, unsigned(n)));
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> pool;
+	for (unsigned t=0; t<nthreads; t++) {
+		pool.push_back(std::thread([n, &next, &f]() {
+			size_t i;
+			while ((i = next++) < n) {
+				f(i);
+			}
+		}));
+	}
+	for (size_t t=0; t<pool.size(); t++) pool[t].join();
+	return nthreads;
+}
+
+
 #endif
@@ -5,11 +5,15 @@ June 2020
 
 #include <cmath>
 #include <vector>
+#include <string>
 #include "wofost.h"
+#include "wofost_batch.h"
 
 #include "Rcpp.h"
 
-std::vector<double> WofostModel::run_batch(std::vector<double> tmin, std::vector<double> tmax, std::vector<double> srad, std::vector<double> prec, std::vector<double> vapr, std::vector<double> wind, std::vector<long> date, std::vector<long> mstart, std::vector<int> soilindex, WofostSoilCollection soils, std::vector<double> depth, std::vector<double> elevation, std::vector<double> latitude) {
+// T is the precision of the weather and the model state
+template <class T>
+std::vector<double> batch_run(WofostCrop &crop, WofostControl &control, std::vector<std::string> &messages, std::vector<double> tmin, std::vector<double> tmax, std::vector<double> srad, std::vector<double> prec, std::vector<double> vapr, std::vector<double> wind, std::vector<long> date, std::vector<long> mstart, std::vector<int> soilindex, const WofostSoilCollection &soils, std::vector<double> depth, std::vector<double> elevation, std::vector<double> latitude) {
 
 
 	bool watlim = control.water_limited;
@@ -35,56 +39,59 @@ std::vector<double> WofostModel::run_batch(std::vector<double> tmin, std::vector
 		}
 		varsoils = true;
 	}
-	soil = soils.soils[0];
-	control.output_option = "BATCH";
-	wth.date = date;
+	WofostBatchModelT<T> m;
+	m.crop = crop;
+	m.control = control;
+	m.soils = &soils;
+	m.latitude = latitude;
+	m.elevation = elevation;
+	m.soilindex = std::vector<int>(nc, 0);
+	if (varsoils) {
+		m.overlay.resize(nc);
+		for (size_t i=0; i<nc; i++) {
+			m.soilindex[i] = soilindex[i] - 1;
+			m.overlay[i].RDMSOL = depth[i];
+		}
+	}
 
+	// cell-major input to day-major; prec, vapr and wind can
+	// be missing (potential production)
+	m.wth.ncells = nc;
+	m.wth.date = date;
+	size_t n = sz * nc;
+	m.wth.tmin.resize(n);
+	m.wth.tmax.resize(n);
+	m.wth.srad.resize(n);
+	m.wth.prec.resize(n, 0);
+	m.wth.vapr.resize(n, 0);
+	m.wth.wind.resize(n, 0);
+	bool hasprec = prec.size() == tmin.size();
+	bool hasvapr = vapr.size() == tmin.size();
+	bool haswind = wind.size() == tmin.size();
 	for (size_t i=0; i<nc; i++) {
-		control.latitude=latitude[i];
-		control.elevation=elevation[i];
-		
 		size_t offset = sz * i;
-		if (std::isnan(tmin[offset])) {
-			continue;
-		}
-		if (watlim) {
-			if (varsoils) {
-				double sidx = soilindex[i]-1;
-				if ((sidx < 0) || sidx >= nsoils) {
-					continue;
-				} 
-				soil = soils.soils[sidx];
-				if (depth[i] >= 0) {
-					soil.p.RDMSOL = depth[i];
-				}
-			}
-		}
-		wth.vapr = std::vector<double>(vapr.begin()+offset, vapr.begin()+offset+sz);
-		wth.wind = std::vector<double>(wind.begin()+offset, wind.begin()+offset+sz);
-		wth.prec = std::vector<double>(prec.begin()+offset, prec.begin()+offset+sz);
-		wth.tmin = std::vector<double>(tmin.begin()+offset, tmin.begin()+offset+sz);
-		wth.tmax = std::vector<double>(tmax.begin()+offset, tmax.begin()+offset+sz);
-		wth.srad = std::vector<double>(srad.begin()+offset, srad.begin()+offset+sz);
-		
-		double yield;
-		for (size_t j=0; j<nsim; j++) {
-			control.modelstart = mstart[j];
-			try {
-				run();
-			} catch(...) {
-				Rcpp::Rcout << "run fail\n";
-				output.values = {NAN};
-			}
-			try {
-				yield = output.values[output.values.size()-1];		
-			} catch(...) {
-				Rcpp::Rcout << "array fail\n";
-				yield = NAN;
-			}
-			out[j*nc+i] = yield;
+		for (size_t t=0; t<sz; t++) {
+			size_t k = t * nc + i;
+			m.wth.tmin[k] = tmin[offset+t];
+			m.wth.tmax[k] = tmax[offset+t];
+			m.wth.srad[k] = srad[offset+t];
+			if (hasprec) m.wth.prec[k] = prec[offset+t];
+			if (hasvapr) m.wth.vapr[k] = vapr[offset+t];
+			if (haswind) m.wth.wind[k] = wind[offset+t];
 		}
 	}
+
+	out = m.run(mstart);
+	// the model goes out of scope; keep its messages
+	messages.insert(messages.end(), m.messages.begin(), m.messages.end());
 	return out;
 }
 
 
+std::vector<double> WofostModel::run_batch(std::vector<double> tmin, std::vector<double> tmax, std::vector<double> srad, std::vector<double> prec, std::vector<double> vapr, std::vector<double> wind, std::vector<long> date, std::vector<long> mstart, std::vector<int> soilindex, const WofostSoilCollection &soils, std::vector<double> depth, std::vector<double> elevation, std::vector<double> latitude) {
+	return batch_run<double>(crop, control, messages, tmin, tmax, srad, prec, vapr, wind, date, mstart, soilindex, soils, depth, elevation, latitude);
+}
+
+std::vector<double> WofostModel::run_batch_float(std::vector<double> tmin, std::vector<double> tmax, std::vector<double> srad, std::vector<double> prec, std::vector<double> vapr, std::vector<double> wind, std::vector<long> date, std::vector<long> mstart, std::vector<int> soilindex, const WofostSoilCollection &soils, std::vector<double> depth, std::vector<double> elevation, std::vector<double> latitude) {
+	return batch_run<float>(crop, control, messages, tmin, tmax, srad, prec, vapr, wind, date, mstart, soilindex, soils, depth, elevation, latitude);
+}
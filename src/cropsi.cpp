@@ -63,6 +63,29 @@ p.RDMCR   R4  crop-dependent maximum rooting depth          cm     O
 #include <math.h>
 #include "wofost.h"
 
+
+// index in LV, SLA and LVAGE of leaf class j (0 is the youngest)
+static inline size_t leaf_class(const WofostCrop &crop, int j) {
+	size_t k = crop.LVHEAD + j;
+	return k < crop.LV.size() ? k : k - crop.LV.size();
+}
+
+// more room for leaf classes; the classes are unrolled to start at 0
+static void leaf_classes_grow(WofostCrop &crop) {
+	size_t n = std::max(2 * crop.LV.size(), size_t(64));
+	std::vector<double> LV(n), SLA(n), LVAGE(n);
+	for (int j = 0; j < crop.ILVOLD; j++) {
+		size_t k = leaf_class(crop, j);
+		LV[j] = crop.LV[k];
+		SLA[j] = crop.SLA[k];
+		LVAGE[j] = crop.LVAGE[k];
+	}
+	crop.LV.swap(LV);
+	crop.SLA.swap(SLA);
+	crop.LVAGE.swap(LVAGE);
+	crop.LVHEAD = 0;
+}
+
 /*
 // used for npk
 void WofostModel::maintanance_respiration() {
@@ -74,6 +97,19 @@ void WofostModel::maintanance_respiration() {
 */
 
 
+void WofostCrop::co2_tables(double CO2) {
+	if ((CO2 == tabCO2) && (p.AMAXTB == tabAMAXTB) && (p.CO2AMAXTB == tabCO2AMAXTB)) return;
+	AMAXTB = p.AMAXTB;
+	double CO2AMAXadj = AFGEN(p.CO2AMAXTB, CO2);
+	for (size_t i=1; i<AMAXTB.size(); i=i+2) {
+		AMAXTB[i] = AMAXTB[i] * CO2AMAXadj;
+	}
+	tabCO2 = CO2;
+	tabAMAXTB = p.AMAXTB;
+	tabCO2AMAXTB = p.CO2AMAXTB;
+}
+
+
 void WofostModel::crop_initialize() {
 // 2.6    initial crop conditions at emergence or transplanting
 	crop.IDANTH = -99;
@@ -86,9 +122,14 @@ void WofostModel::crop_initialize() {
 	crop.Fs = AFGEN(crop.p.FSTB, crop.s.DVS);
 	crop.Fo = AFGEN(crop.p.FOTB, crop.s.DVS);
 
-	//crop.SLA.resize(control.IDURMX + control.cropstart);
-	//crop.LV.resize(control.IDURMX + control.cropstart);
-	//crop.LVAGE.resize(control.IDURMX + control.cropstart);
+	// a new leaf class is formed every day
+	size_t nclass = std::max(control.IDURMX, 0) + 2;
+	if (crop.LV.size() < nclass) {
+		crop.LV.resize(nclass);
+		crop.SLA.resize(nclass);
+		crop.LVAGE.resize(nclass);
+	}
+	crop.LVHEAD = 0;
 	crop.SLA[0] = AFGEN(crop.p.SLATB, crop.s.DVS);
 	crop.LVAGE[0] = 0.;
 	crop.ILVOLD = 1;
@@ -114,6 +155,7 @@ void WofostModel::crop_initialize() {
 	
     crop.p.LAIEM = crop.s.WLV * crop.SLA[0];
     crop.LV[0] = crop.s.WLV;
+    crop.LVSUM = crop.s.WLV;
     crop.LASUM = crop.p.LAIEM;
     crop.s.LAIEXP = crop.p.LAIEM;
     crop.s.SAI = crop.s.WST * AFGEN(crop.p.SSATB, crop.s.DVS);
@@ -192,7 +234,7 @@ void WofostModel::crop_rates() {
   // 2.20   daily dry matter production
   //gross assimilation and correction for sub-optimum average day temperature
 
-	crop.AMAX = AFGEN(crop.p.AMAXTB, crop.s.DVS) * AFGEN(crop.p.TMPFTB, atm.DTEMP);
+	crop.AMAX = AFGEN(crop.AMAXTB, crop.s.DVS) * AFGEN(crop.p.TMPFTB, atm.DTEMP);
 	crop.KDif = AFGEN(crop.p.KDIFTB, crop.s.DVS);
 	crop.EFF = AFGEN(crop.p.EFFTB, atm.DTEMP);
 
@@ -314,20 +356,20 @@ void WofostModel::crop_rates() {
   //determine extra death due to exceeding of life p.SPAN of leaves leaf death is imposed on array until no more leaves have to die or all leaves are gone
 	double REST = crop.DSLV;
 	int i1 = crop.ILVOLD;
-	while (REST > crop.LV[i1 - 1] && i1 >= 1){
-		REST = REST - crop.LV[i1 - 1];
+	while (i1 >= 1 && REST > crop.LV[leaf_class(crop, i1 - 1)]){
+		REST = REST - crop.LV[leaf_class(crop, i1 - 1)];
 		i1--;
 	}
 
   //check if some of the remaining leaves are older than p.SPAN, sum their weights
 	double DALV = 0.;
-	if (crop.LVAGE[i1 - 1] > crop.p.SPAN && REST > 0. && i1 >= 1) {
-		DALV = crop.LV[i1 - 1] - REST;
+	if (i1 >= 1 && crop.LVAGE[leaf_class(crop, i1 - 1)] > crop.p.SPAN && REST > 0.) {
+		DALV = crop.LV[leaf_class(crop, i1 - 1)] - REST;
 		REST = 0.;
 		i1--;
 	}
-	while (i1 >= 1 && crop.LVAGE[i1 - 1] > crop.p.SPAN) {
-		DALV += crop.LV[i1 - 1];
+	while (i1 >= 1 && crop.LVAGE[leaf_class(crop, i1 - 1)] > crop.p.SPAN) {
+		DALV += crop.LV[leaf_class(crop, i1 - 1)];
 		i1--;
 	}
   //death rate leaves and growth rate living leaves
@@ -390,45 +432,55 @@ void WofostModel::crop_states() {
 
 
   //leaf death is imposed on array until no more leaves have to die or all leaves are gone
+  //leaf area and weight are updated for the leaves that die
 	double DSLVT = crop.DSLV;
 	int i1 = crop.ILVOLD;
 	while(DSLVT > 0. && i1 >= 1){
-		if (DSLVT >= crop.LV[i1 - 1]){
-			DSLVT = DSLVT - crop.LV[i1 - 1];
-			crop.LV[i1 - 1] = 0.;
+		size_t k = leaf_class(crop, i1 - 1);
+		if (DSLVT >= crop.LV[k]){
+			DSLVT = DSLVT - crop.LV[k];
+			crop.LASUM -= crop.LV[k] * crop.SLA[k];
+			crop.LVSUM -= crop.LV[k];
+			crop.LV[k] = 0.;
 			i1--;
 		} else {
-			crop.LV[i1 - 1] = crop.LV[i1 - 1] - DSLVT;
+			crop.LV[k] = crop.LV[k] - DSLVT;
+			crop.LASUM -= DSLVT * crop.SLA[k];
+			crop.LVSUM -= DSLVT;
 			DSLVT = 0.;
 		}
 	}
 
-	while(crop.LVAGE[i1 - 1] >= crop.p.SPAN && i1 >= 1){
-		crop.LV[i1 - 1] = 0.;
+	while(i1 >= 1 && crop.LVAGE[leaf_class(crop, i1 - 1)] >= crop.p.SPAN){
+		size_t k = leaf_class(crop, i1 - 1);
+		crop.LASUM -= crop.LV[k] * crop.SLA[k];
+		crop.LVSUM -= crop.LV[k];
+		crop.LV[k] = 0.;
 		i1--;
 	}
+	if (i1 == 0) {
+		crop.LASUM = 0.;
+		crop.LVSUM = 0.;
+	}
 
 	crop.ILVOLD = i1;
-  //shifting of contents, integration of physiological age
-
-	for(int j = crop.ILVOLD; j >= 1; j--){
-		crop.LV[j] = crop.LV[j - 1];
-		crop.SLA[j] = crop.SLA[j - 1];
-		crop.LVAGE[j] = crop.LVAGE[j - 1] + crop.r.FYSDEL;
+  //integration of physiological age
+	for (int j = 0; j < crop.ILVOLD; j++){
+		crop.LVAGE[leaf_class(crop, j)] += crop.r.FYSDEL;
 	}
-	crop.ILVOLD++;
 
   //new leaves in class 1
-	crop.LV[0] = crop.s.GRLV;
-	crop.SLA[0] = crop.SLAT;
-	crop.LVAGE[0] = 0.;
-  //calculation of new leaf area and weight
-	crop.LASUM = 0.;
-	crop.s.WLV = 0.;
-	for (int j = 0; j < crop.ILVOLD; j++){
-		crop.LASUM += crop.LV[j] * crop.SLA[j];
-		crop.s.WLV += crop.LV[j];
+	if (crop.ILVOLD >= int(crop.LV.size())) {
+		leaf_classes_grow(crop);
 	}
+	crop.LVHEAD = crop.LVHEAD == 0 ? crop.LV.size() - 1 : crop.LVHEAD - 1;
+	crop.ILVOLD++;
+	crop.LV[crop.LVHEAD] = crop.s.GRLV;
+	crop.SLA[crop.LVHEAD] = crop.SLAT;
+	crop.LVAGE[crop.LVHEAD] = 0.;
+	crop.LASUM += crop.s.GRLV * crop.SLAT;
+	crop.LVSUM += crop.s.GRLV;
+	crop.s.WLV = crop.LVSUM;
 
 	crop.s.LAIEXP += crop.r.GLAIEX;
   //dry weight of living plant organs and total above ground biomass
@@ -35,6 +35,8 @@ double SWEAF(double ET0, double CGNR){
 
 
 
+// WL: water limited; OX: oxygen stress (IOXWL and no airducts)
+template <bool WL, bool OX>
 void WofostModel::EVTRA() {
 
 // bool IOXWL, int p.IAIRDU, double KDif, double p.CFET, double p.DEPNR,
@@ -52,7 +54,7 @@ void WofostModel::EVTRA() {
     crop.TRAMX = std::max(0.0001, atm.ET0*(1. - EKL));
 
      //actual transpiration rate
-    if (! control.water_limited) {
+    if (!WL) {
         crop.TRA  = crop.TRAMX;
     } else {
         //calculation critical soil moisture content
@@ -67,7 +69,7 @@ void WofostModel::EVTRA() {
         //reduction in transpiration in case of oxygen shortage
         //for non-rice crops and possibly deficient land drainage        
 	    double RFOS = 1.;
-		if ((!crop.p.IAIRDU) && (control.IOXWL)){
+		if (OX) {
             //critical soil moisture content for aeration
             double SMAIR = soil.p.SM0 - soil.p.CRAIRC;
             //count days since start oxygen shortage (up to 4 days)
@@ -85,3 +87,7 @@ void WofostModel::EVTRA() {
 		crop.TRANRF = crop.TRA / crop.TRAMX;		
     }
 }
+
+template void WofostModel::EVTRA<false, false>();
+template void WofostModel::EVTRA<true, false>();
+template void WofostModel::EVTRA<true, true>();
@@ -25,28 +25,33 @@ void WofostModel::soil_initialize() {
 }
 
 
+// W is known at compile time, so only one branch remains
+template <int W>
 void WofostModel::soil_rates() {
-
-	if (control.water_limited) {
-		if (soil.p.IZT) {
-			WATGW_rates();
-		} else {
-			WATFD_rates();
-		}
+	if (W == WATBAL_GW) {
+		WATGW_rates();
+	} else if (W == WATBAL_FD) {
+		WATFD_rates();
 	} else {
 		WATPP_rates();
 	}
 }
 
+template <int W>
 void WofostModel::soil_states() {
-	if (control.water_limited) {
-		if (soil.p.IZT) {
-			WATGW_states();
-		} else {
-			WATFD_states();
-		}
+	if (W == WATBAL_GW) {
+		WATGW_states();
+	} else if (W == WATBAL_FD) {
+		WATFD_states();
 	} else {
 		WATPP_states();
 	}
 }
 
+template void WofostModel::soil_rates<WATBAL_PP>();
+template void WofostModel::soil_rates<WATBAL_FD>();
+template void WofostModel::soil_rates<WATBAL_GW>();
+template void WofostModel::soil_states<WATBAL_PP>();
+template void WofostModel::soil_states<WATBAL_FD>();
+template void WofostModel::soil_states<WATBAL_GW>();
+
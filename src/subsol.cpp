@@ -23,10 +23,11 @@ The integration goes at most over four intervals : [0,45],[45,170], [170,330] an
 #include <cmath>
 #include <vector>
 #include "wofost.h"
+#include "subsol.h"
 #include "SimUtil.h"
 
 
-double SUBSOL(double PF, double D, std::vector<double> CONTAB) { // flow is output
+double SUBSOL(double PF, double D, const std::vector<double> &CONTAB) { // flow is output
 
 //15.1 declarations and constants
       
@@ -58,37 +59,31 @@ double SUBSOL(double PF, double D, std::vector<double> CONTAB) { // flow is outp
       for(int i = 0; i < 4; i++){
          if (i <= 2) {
             DEL[i] = std::min(START[i + 1], MH) - START[i];
-         } else if (i == 4) {
+         } else {
             DEL[i] = PF1 - LOGST4;
 		 }
-         if(DEL[i] <= 0.){
-            for(int j = 0; j < IINT; j++){
-               for(int k = 0; k < 3; k++){
-                  I3 = 3 * (j - 1) + k;
-                  PFGAU[I3] = PFSTAN[I3];
-                  if (j == IINT){
-                  // the three points in the last interval are calculated
-                     if(IINT <= 3) PFGAU[I3] = log10(START[IINT] + PGAU[k] * DEL[IINT]);
-                     if(IINT == 4) PFGAU[I3] = LOGST4 + PGAU[k] * DEL[IINT];
-                     CONDUC[I3] = std::exp( ELOG10 * AFGEN(CONTAB, PFGAU[I3]) );
-                     HULP[I3]   = DEL[j] * WGAU[k] * CONDUC[I3];
-                     if(I3 > 9) HULP[I3] = HULP[I3] * ELOG10 * std::exp( ELOG10 * PFGAU[I3] );
-                  }
-                  else{
-                     // the three points in the full-width intervals are standard
-                     // variables needed in the loop below
-                     CONDUC[I3] = std::exp( ELOG10 * AFGEN(CONTAB, PFGAU[I3]) );
-                     HULP[I3]   = DEL[j] * WGAU[k] * CONDUC[I3];
-                     if(I3 > 9) HULP[I3] = HULP[I3] * ELOG10 * std::exp( ELOG10 * PFGAU[I3] );
-                  }
-               }
-            }
-         }
+         if(DEL[i] <= 0.) break;
          IINT = IINT+1;
       }
 
 //15.4 preparation of three-point Gaussian integration
-
+      for(int j = 0; j < IINT; j++){
+         for(int k = 0; k < 3; k++){
+            I3 = 3 * j + k;
+            if (j == (IINT - 1)){
+            // the three points in the last interval are calculated
+               if(IINT <= 3) PFGAU[I3] = log10(START[j] + PGAU[k] * DEL[j]);
+               if(IINT == 4) PFGAU[I3] = LOGST4 + PGAU[k] * DEL[j];
+            } else {
+            // the three points in the full-width intervals are standard
+               PFGAU[I3] = PFSTAN[I3];
+            }
+            // variables needed in the loop below
+            CONDUC[I3] = std::exp( ELOG10 * AFGEN(CONTAB, PFGAU[I3]) );
+            HULP[I3]   = DEL[j] * WGAU[k] * CONDUC[I3];
+            if(I3 > 8) HULP[I3] = HULP[I3] * ELOG10 * std::exp( ELOG10 * PFGAU[I3] );
+         }
+      }
 
 //15.5 setting upper and lower limit
       double FU =  1.27;
@@ -106,8 +101,7 @@ double SUBSOL(double PF, double D, std::vector<double> CONTAB) { // flow is outp
          double FLW = (FU+FL)/2.;
          double DF  = (FU-FL)/2.;
          if ( (DF < 0.01) && ( (DF/std::abs(FLW)) < 0.1)){
-            FLOW = (FU+FL)/2.;
-            return FLOW;
+            break;
          }
          double Z = 0.;
          for(int j = 0 ; j < IMAX; j++) {
@@ -116,6 +110,67 @@ double SUBSOL(double PF, double D, std::vector<double> CONTAB) { // flow is outp
          if (Z >= D1) FL = FLW;
          if (Z <= D1) FU = FLW;
       }
+      FLOW = (FU+FL)/2.;
       return FLOW;
 }
 
+
+
+// SUBSOL on a grid of pF and U = log10(D / MH). The flow is zero at
+// D = MH and changes steeply (and sign) close to it; the steps in U go
+// from 0.0001 at U = 0 up to 0.02. There are separate tables for
+// capillary rise (D < MH) and percolation (D > MH). pF goes from 0 to the
+// highest pF in SMTAB, D from 0.1 to 1000 cm (the maximum depth of the
+// groundwater)
+void SubsolTable::build(const std::vector<double> &CONTAB, double pfmax) {
+	dpf = 0.05;
+	npf = size_t(std::ceil(std::max(pfmax, 0.1) / dpf)) + 1;
+	double umax = std::max(1. + (npf - 1) * dpf, 3.);
+	U.resize(0);
+	U.push_back(0.);
+	double h = 0.0001;
+	while (U.back() < umax) {
+		U.push_back(U.back() + h);
+		h = std::min(h * 1.1, 0.02);
+	}
+	size_t n = U.size();
+	rise.resize(npf * n);
+	perc.resize(npf * n);
+	for (size_t i=0; i<npf; i++) {
+		// PF <= 0 is not tabulated
+		double PF = std::max(i * dpf, 0.0001);
+		double MH = std::pow(10., PF);
+		for (size_t j=0; j<n; j++) {
+			double u = std::max(U[j], 1e-9);
+			rise[i * n + j] = SUBSOL(PF, MH * std::pow(10., -u), CONTAB);
+			perc[i * n + j] = SUBSOL(PF, MH * std::pow(10., u), CONTAB);
+		}
+	}
+}
+
+
+// bilinear interpolation; SUBSOL outside the table
+double SubsolTable::get(double PF, double D, const std::vector<double> &CONTAB) const {
+	if ((PF <= 0) || (D < 0.1) || (D > 1000) || (npf == 0)) {
+		return SUBSOL(PF, D, CONTAB);
+	}
+	double x = PF / dpf;
+	double u = std::log10(D) - PF;
+	if ((x > (npf - 1)) || (u == 0)) {
+		return SUBSOL(PF, D, CONTAB);
+	}
+	const std::vector<double> &tab = u < 0 ? rise : perc;
+	u = std::abs(u);
+	size_t n = U.size();
+	if (u >= U[n-1]) {
+		return SUBSOL(PF, D, CONTAB);
+	}
+	size_t j = std::upper_bound(U.begin(), U.end(), u) - U.begin() - 1;
+	size_t i = std::min(size_t(x), npf - 2);
+	double fx = x - i;
+	double fy = (u - U[j]) / (U[j+1] - U[j]);
+	const double *f = &tab[i * n + j];
+	double f0 = f[0] + fy * (f[1] - f[0]);
+	double f1 = f[n] + fy * (f[n + 1] - f[n]);
+	return f0 + fx * (f1 - f0);
+}
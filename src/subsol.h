@@ -1,2 +1,20 @@
+#ifndef SUBSOL_H_
+#define SUBSOL_H_
 
-double SUBSOL (double PF, double D, std::vector<double> CONTAB);// flow is output
+#include <vector>
+
+double SUBSOL (double PF, double D, const std::vector<double> &CONTAB);// flow is output
+
+// SUBSOL tabulated for a soil (CONTAB)
+class SubsolTable {
+public:
+	virtual ~SubsolTable(){}
+	double dpf;
+	size_t npf = 0;
+	std::vector<double> U, rise, perc;
+
+	void build(const std::vector<double> &CONTAB, double pfmax);
+	double get(double PF, double D, const std::vector<double> &CONTAB) const;
+};
+
+#endif
@@ -60,6 +60,9 @@ SMFCF   R*4  soil moisture content at field capacity          cm3 cm-3  O
 
 //int main(){return(0);}
 
+// infiltration parameters WOFOST_WRR
+static const std::vector<double> NINFTB_WRR = {0.0, 0.0, 0.5, 0.0, 1.5, 1.0, 0.0, 0.0};
+
 
 void WofostModel::WATFD_initialize() {
 	//old rooting depth
@@ -113,7 +116,8 @@ void WofostModel::WATFD_initialize() {
     // infiltration parameters WOFOST_WRR
     // this is a multiplier for non-infiltrating fraction of rainfall as a function of daily rainfall
     // RH: this needs to become an input variable?
-    soil.p.NINFTB = {0.0, 0.0, 0.5, 0.0, 1.5, 1.0, 0.0, 0.0};
+    // (copied only the first time the soil is used)
+    if (soil.p.NINFTB != NINFTB_WRR) soil.p.NINFTB = NINFTB_WRR;
 	
 }
 
@@ -70,9 +70,7 @@ SMFCF   R*4  soil moisture content at field capacity          cm3 cm-3  O
 #include <math.h>
 
 
-void WofostModel::WATGW_initialize() {
-    //!!!  DATA XDEF/16000./
-    double XDEF = 1000.;
+void WofostSoil::groundwater_tables() {
     //     mathematical parameters
     double PGAU[3] = {0.1127016654, 0.5, 0.8872983346};
     double WGAU[3] = {0.2777778, 0.4444444, 0.2777778};
@@ -80,22 +78,20 @@ void WofostModel::WATGW_initialize() {
 //      DATA p.NINFTB/0.0,0.00, 0.5,0.12, 1.0,0.29,
 //                   2.0,0.71, 3.0,0.91, 7.0,1.00, 8*0./
 //     infiltration parameters WOFOST_WRR
-    soil.p.NINFTB = {0.0, 0.0, 0.5, 0.0, 1.5, 1.0, 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.};
+    p.NINFTB = {0.0, 0.0, 0.5, 0.0, 1.5, 1.0, 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.};
     
-    soil.p.SMFCF = AFGEN(soil.p.SMTAB, log10(200.));
-    soil.p.SMW = AFGEN(soil.p.SMTAB, log10(16000.));
-    soil.p.SM0 = AFGEN(soil.p.SMTAB, -1.);
+    p.SMFCF = AFGEN(p.SMTAB, log10(200.));
+    p.SMW = AFGEN(p.SMTAB, log10(16000.));
+    p.SM0 = AFGEN(p.SMTAB, -1.);
     
-    soil.p.K0 = pow(10., AFGEN(soil.p.CONTAB, -1.));
+    p.K0 = pow(10., AFGEN(p.CONTAB, -1.));
 
-    int ILSM = soil.p.SMTAB.size();
-    soil.p.PFTAB.resize(ILSM);
+    int ILSM = p.SMTAB.size();
+    p.PFTAB.resize(ILSM);
     for(int i = 2; i <= ILSM; i = i + 2){
-        soil.p.PFTAB[ILSM - i] = soil.p.SMTAB[i - 1];
-        soil.p.PFTAB[ILSM + 1 - i] = soil.p.SMTAB[i - 2];
+        p.PFTAB[ILSM - i] = p.SMTAB[i - 1];
+        p.PFTAB[ILSM + 1 - i] = p.SMTAB[i - 2];
     }
-    soil.RTDF = 0.;
-    //        old rooting depth
 
     //------------------------------------------------------
 //        soil air volume above watertable at equilibrium
@@ -107,30 +103,67 @@ void WofostModel::WATGW_initialize() {
 //        method is 3 point gaup.SSIan integration of SM on each interval.
 //        Table DEFDTB is the inverse function of SDEFTB.
 
-
-    crop.s.RDOLD = crop.s.RD;
-    soil.MH0 = 0.;
-    soil.MH1 = 2.;
-    soil.SDEFTB.resize(30);
-    soil.DEFDTB.resize(30);
-    soil.SDEFTB[0] = 0.;
-    soil.SDEFTB[1] = 0.;
-    soil.DEFDTB[0] = 0.;
-    soil.DEFDTB[1] = 0.;
+    MH0 = 0.;
+    MH1 = 2.;
+    SDEFTB.resize(30);
+    DEFDTB.resize(30);
+    SDEFTB[0] = 0.;
+    SDEFTB[1] = 0.;
+    DEFDTB[0] = 0.;
+    DEFDTB[1] = 0.;
 
     int i2 = 0;
     for(int i = 2; i <= 15; i++){
         i2 = 2*i;
-        soil.SDEFTB[i2 - 2] = soil.MH1;
-        soil.SDEFTB[i2 - 1] = soil.SDEFTB[i2 - 3];
+        SDEFTB[i2 - 2] = MH1;
+        SDEFTB[i2 - 1] = SDEFTB[i2 - 3];
         for(int j = 0; j < 3; j++){
-            soil.SDEFTB[i2 - 1] = soil.SDEFTB[i2 - 1] + WGAU[j] * (soil.MH1 - soil.MH0) * (soil.p.SM0 - AFGEN(soil.p.SMTAB, log10(soil.MH0 + (soil.MH1 - soil.MH0)*PGAU[j])));
+            SDEFTB[i2 - 1] = SDEFTB[i2 - 1] + WGAU[j] * (MH1 - MH0) * (p.SM0 - AFGEN(p.SMTAB, log10(MH0 + (MH1 - MH0)*PGAU[j])));
         }
-        soil.DEFDTB[i2 - 2] = soil.SDEFTB[i2 - 1];
-        soil.DEFDTB[i2 - 1] = soil.SDEFTB[i2 - 2];
-        soil.MH0 = soil.MH1;
-        soil.MH1 = 2 * soil.MH1;
+        DEFDTB[i2 - 2] = SDEFTB[i2 - 1];
+        DEFDTB[i2 - 1] = SDEFTB[i2 - 2];
+        MH0 = MH1;
+        MH1 = 2 * MH1;
+    }
+    gwtables = true;
+    tabSMTAB = p.SMTAB;
+    tabCONTAB = p.CONTAB;
+}
+
+
+// tabulated SUBSOL, used if control.subsol_table > 0
+void WofostSoil::flow_table() {
+    // highest pF in SMTAB
+    FLOWTB.build(p.CONTAB, p.SMTAB[p.SMTAB.size() - 2]);
+}
+
+
+bool WofostSoil::tables_current(bool flow) const {
+    return gwtables && (p.SMTAB == tabSMTAB) && (p.CONTAB == tabCONTAB) && (!flow || (FLOWTB.npf > 0));
+}
+
+
+void WofostSoil::update_tables(bool flow) {
+    if (gwtables && ((p.SMTAB != tabSMTAB) || (p.CONTAB != tabCONTAB))) {
+        gwtables = false;
+        FLOWTB.npf = 0;
     }
+    if (!gwtables) groundwater_tables();
+    if (flow && (FLOWTB.npf == 0)) flow_table();
+}
+
+
+void WofostModel::WATGW_initialize() {
+    //!!!  DATA XDEF/16000./
+    double XDEF = 1000.;
+
+    // computed once per soil
+    soil.update_tables(control.subsol_table > 0);
+    soil.FLOWDEV = 0.;
+
+    soil.RTDF = 0.;
+    //        old rooting depth
+    crop.s.RDOLD = crop.s.RD;
         //-----------------------------------------------------
 //        initial state variables of the water balance
 //-----------------------------------------------------
@@ -140,16 +173,16 @@ void WofostModel::WATGW_initialize() {
         soil.ZT = std::max(soil.ZT, soil.p.DD);
     }
     //        amount of air in soil below rooted zone
-    soil.SUBAIR = AFGEN(soil.SDEFTB, soil.ZT - crop.s.RD);
+    soil.SUBAIR = AFGENLOG2(soil.SDEFTB, soil.ZT - crop.s.RD);
 
     //        amount of moisture in soil below rooted zone
     soil.WZ = (XDEF - crop.s.RD) * soil.p.SM0 - soil.SUBAIR;
     soil.WZI = soil.WZ;
     //        equilibrium amount of soil moisture in rooted zone
 
-    soil.WE = soil.p.SM0 * crop.s.RD + soil.SUBAIR - AFGEN(soil.SDEFTB, soil.ZT);
+    soil.WE = soil.p.SM0 * crop.s.RD + soil.SUBAIR - AFGENLOG2(soil.SDEFTB, soil.ZT);
     //        equilibrium amount of moisture above drains up to the surface
-    soil.WEDTOT = soil.p.SM0 * soil.p.DD - AFGEN(soil.SDEFTB, soil.p.DD);
+    soil.WEDTOT = soil.p.SM0 * soil.p.DD - AFGENLOG2(soil.SDEFTB, soil.p.DD);
 //        initial moisture content in rooted zone
     if(soil.ZT < crop.s.RD + 100.){
         //           groundwater in or close to rootzone
@@ -243,12 +276,20 @@ void WofostModel::WATGW_rates() {
     if(ZTMRD > 0.){
         //           groundwater table below rooted zone:
         //           equilibrium amount of soil moisture in rooted zone
-        soil.WE = soil.p.SM0 * crop.s.RD + soil.SUBAIR - AFGEN(soil.SDEFTB, soil.ZT);
+        soil.WE = soil.p.SM0 * crop.s.RD + soil.SUBAIR - AFGENLOG2(soil.SDEFTB, soil.ZT);
         //           soil suction
         soil.PF = AFGEN(soil.p.PFTAB, soil.SM);
         //           calculate capillary flow
         //call subsol;
-        double FLOW = SUBSOL(soil.PF, ZTMRD, soil.p.CONTAB);
+        double FLOW;
+        if (control.subsol_table > 0) {
+            FLOW = soil.FLOWTB.get(soil.PF, ZTMRD, soil.p.CONTAB);
+            if (control.subsol_table == 2) {
+                soil.FLOWDEV = std::max(soil.FLOWDEV, std::abs(FLOW - SUBSOL(soil.PF, ZTMRD, soil.p.CONTAB)));
+            }
+        } else {
+            FLOW = SUBSOL(soil.PF, ZTMRD, soil.p.CONTAB);
+        }
         //           flow is accounted for as capillary rise or percolation
         if(FLOW >= 0.){
             soil.CR = std::min(FLOW, std::max(soil.WE - soil.W, 0.));
@@ -276,7 +317,7 @@ void WofostModel::WATGW_rates() {
             //              and equilibrium water above groundwater level (both until
             //              root zone).
 
-            DR2 = (AFGEN(soil.SDEFTB, soil.p.DD - crop.s.RD) - soil.SUBAIR);
+            DR2 = (AFGENLOG2(soil.SDEFTB, soil.p.DD - crop.s.RD) - soil.SUBAIR);
             soil.DMAX = std::min(DR1, DR2);
         }
 
@@ -310,7 +351,7 @@ void WofostModel::WATGW_rates() {
             soil.CR = (soil.DZ - (crop.s.RD - soil.ZT)) * AIRC;
             //              new equilibrium groundwater depth, based on the soil water
             //              deficit
-            soil.DZ = (AFGEN(soil.DEFDTB, soil.CR) + crop.s.RD - soil.ZT);
+            soil.DZ = (AFGENBIN(soil.DEFDTB, soil.CR) + crop.s.RD - soil.ZT);
         }
     }else{
         //           groundwater table below rootzone
@@ -319,7 +360,7 @@ void WofostModel::WATGW_rates() {
         if(DEF1 < 0.){
             soil.PERC = soil.PERC + DEF1;
         }
-        soil.DZ = (AFGEN(soil.DEFDTB, DEF1) + crop.s.RD - soil.ZT);
+        soil.DZ = (AFGENBIN(soil.DEFDTB, DEF1) + crop.s.RD - soil.ZT);
         //           infiltration rate not to exceed available soil air volume
         soil.RIN = std::min(RINPRE, (soil.p.SM0 - soil.SM - 0.0004) * crop.s.RD + crop.TRA + soil.EVS + soil.PERC - soil.CR);
     }
@@ -363,7 +404,7 @@ void WofostModel::WATGW_states(){
     //        groundwater depth
     soil.ZT += soil.DZ;
     //        amount of air and water below rooted zone
-    soil.SUBAIR = AFGEN(soil.SDEFTB, soil.ZT - crop.s.RDOLD);
+    soil.SUBAIR = AFGENLOG2(soil.SDEFTB, soil.ZT - crop.s.RDOLD);
     double XDEF = 1000.;
     soil.WZ = (XDEF - crop.s.RDOLD) * soil.p.SM0 - soil.SUBAIR;
 
@@ -374,7 +415,7 @@ void WofostModel::WATGW_states(){
     if(crop.s.RD - crop.s.RDOLD > 0.001){
         //           save old value SUBAIR, new values SUBAIR and WZ
         double SUBAI0 = soil.SUBAIR;
-        soil.SUBAIR = AFGEN(soil.SDEFTB, soil.ZT - crop.s.RD);
+        soil.SUBAIR = AFGENLOG2(soil.SDEFTB, soil.ZT - crop.s.RD);
         soil.WZ = (XDEF - crop.s.RD) * soil.p.SM0 - soil.SUBAIR;
         //           water added to rooted zone by root growth
         double WDR = soil.p.SM0 * (crop.s.RD - crop.s.RDOLD) - (SUBAI0 - soil.SUBAIR);
@@ -408,11 +449,8 @@ void WofostModel::WATGW_states(){
 }
 
 
-
-
-
-
-
-
-
-
+void WofostModel::WATGW_report() {
+    if (control.water_limited && soil.p.IZT && (control.subsol_table == 2)) {
+        messages.push_back("maximum deviation of the tabulated SUBSOL flow: " + std::to_string(soil.FLOWDEV) + " cm/d");
+    }
+}
@@ -6,12 +6,14 @@ License: GNU General Public License (GNU GPL) v. 2
 */
 
 #include <vector>
+#include <algorithm>
 #include "wofost.h"
 #include "SimUtil.h"
 #include <math.h>
 #include <string.h>
 //#include <iostream>
 
+template <int W, bool OX>
 bool WofostModel::weather_step() {
 
 	if (time >= wth.tmin.size()) {
@@ -56,7 +58,7 @@ bool WofostModel::weather_step() {
 		PENMAN_MONTEITH(); // ET0
 
 	//(evapo)transpiration rates
-		EVTRA();
+		EVTRA<W != WATBAL_PP, OX>();
 
 		//soil.EVWMX = atm.E0;
 		//soil.EVSMX = atm.ES0;
@@ -66,34 +68,202 @@ bool WofostModel::weather_step() {
 }
 
 
-void WofostModel::model_output(){
-	if (control.output_option == "TEST") {
-		output.values.insert(output.values.end(),
-			{double(step), atm.ANGOT, atm.ATMTR, atm.COSLD, atm.DAYL,
-				atm.DAYLP, atm.DifPP, atm.DSINBE, atm.SINLD, soil.EVWMX,
-				crop.s.TSUM, crop.r.DVR, crop.s.DVS, soil.EVS, crop.s.LAI, crop.LASUM,
-				crop.s.SAI, crop.PGASS, crop.s.RD, soil.SM,  crop.Fl, crop.Fo, crop.Fr, crop.Fs,
-				crop.PMRES,	crop.s.TAGP, crop.TRA, crop.TRAMX, crop.RFTRA,
-				crop.s.WRT, crop.s.WLV, crop.s.WST, crop.s.WSO,
-				crop.s.TWRT, crop.s.TWLV, crop.s.TWST, crop.s.TWSO, crop.s.GRLV, crop.SLAT
-			}
-		);
-	} else if (control.output_option == "BATCH") {
-		output.values.push_back(crop.s.WSO);
+void WofostOutput::start(size_t rows) {
+	nrow = 0;
+	if (sink != NULL) {
+		cap = 0;
+		values.resize(0);
+		rowvalues.resize(vars.size());
+		sink->start(names);
 	} else {
-		output.values.insert(output.values.end(),
-			{double(step), crop.s.TSUM, crop.s.DVS, crop.s.LAI,
-				crop.s.WRT, crop.s.WLV, crop.s.WST, crop.s.WSO,
-				crop.TRA, soil.EVS, soil.EVW, soil.SM
-			}
-		);
+		cap = rows;
+		values.resize(vars.size() * cap);
+	}
+}
+
+void WofostOutput::single(const std::vector<double> &v) {
+	nrow = cap = 1;
+	if (sink != NULL) {
+		sink->row(v.data(), v.size());
+	} else {
+		values = v;
+	}
+}
+
+void WofostOutput::grow(size_t rows) {
+	std::vector<double> v(vars.size() * rows);
+	for (size_t j=0; j<vars.size(); j++) {
+		std::copy(values.begin() + j * cap, values.begin() + j * cap + nrow, v.begin() + j * rows);
+	}
+	values.swap(v);
+	cap = rows;
+}
+
+// remove the unused rows
+void WofostOutput::finish() {
+	if (sink != NULL) {
+		sink->finish();
+		return;
+	}
+	if (cap == nrow) return;
+	for (size_t j=1; j<vars.size(); j++) {
+		std::copy(values.begin() + j * cap, values.begin() + j * cap + nrow, values.begin() + j * nrow);
+	}
+	values.resize(vars.size() * nrow);
+	cap = nrow;
+}
+
+
+// output variables by name
+template <class C>
+struct OutputVariable {
+	const char *name;
+	double C::*field;
+};
+
+static const OutputVariable<WofostAtmosphere> atm_output[] = {
+	{"RAIN", &WofostAtmosphere::RAIN}, {"AVRAD", &WofostAtmosphere::AVRAD}, {"TEMP", &WofostAtmosphere::TEMP},
+	{"DTEMP", &WofostAtmosphere::DTEMP}, {"TMIN", &WofostAtmosphere::TMIN}, {"TMAX", &WofostAtmosphere::TMAX},
+	{"E0", &WofostAtmosphere::E0}, {"ES0", &WofostAtmosphere::ES0}, {"ET0", &WofostAtmosphere::ET0},
+	{"DAYL", &WofostAtmosphere::DAYL}, {"DAYLP", &WofostAtmosphere::DAYLP}, {"WIND", &WofostAtmosphere::WIND},
+	{"VAP", &WofostAtmosphere::VAP}, {"SINLD", &WofostAtmosphere::SINLD}, {"COSLD", &WofostAtmosphere::COSLD},
+	{"DSINB", &WofostAtmosphere::DSINB}, {"DSINBE", &WofostAtmosphere::DSINBE}, {"DIFPP", &WofostAtmosphere::DifPP},
+	{"ATMTR", &WofostAtmosphere::ATMTR}, {"ANGOT", &WofostAtmosphere::ANGOT}
+};
+
+static const OutputVariable<WofostCropStates> crop_state_output[] = {
+	{"RD", &WofostCropStates::RD}, {"GRLV", &WofostCropStates::GRLV}, {"DWRT", &WofostCropStates::DWRT},
+	{"DWLV", &WofostCropStates::DWLV}, {"DWST", &WofostCropStates::DWST}, {"DWSO", &WofostCropStates::DWSO},
+	{"DVS", &WofostCropStates::DVS}, {"LAI", &WofostCropStates::LAI}, {"LAIEXP", &WofostCropStates::LAIEXP},
+	{"SAI", &WofostCropStates::SAI}, {"PAI", &WofostCropStates::PAI}, {"WRT", &WofostCropStates::WRT},
+	{"WLV", &WofostCropStates::WLV}, {"WST", &WofostCropStates::WST}, {"WSO", &WofostCropStates::WSO},
+	{"TWRT", &WofostCropStates::TWRT}, {"TWLV", &WofostCropStates::TWLV}, {"TWST", &WofostCropStates::TWST},
+	{"TWSO", &WofostCropStates::TWSO}, {"TAGP", &WofostCropStates::TAGP}, {"TSUM", &WofostCropStates::TSUM},
+	{"TSUME", &WofostCropStates::TSUME}, {"TADW", &WofostCropStates::TADW}
+};
+
+static const OutputVariable<WofostCropRates> crop_rate_output[] = {
+	{"GASS", &WofostCropRates::GASS}, {"GWST", &WofostCropRates::GWST}, {"GWSO", &WofostCropRates::GWSO},
+	{"DRST", &WofostCropRates::DRST}, {"DRLV", &WofostCropRates::DRLV}, {"DRRT", &WofostCropRates::DRRT},
+	{"GWRT", &WofostCropRates::GWRT}, {"DRSO", &WofostCropRates::DRSO}, {"DVR", &WofostCropRates::DVR},
+	{"DTSUME", &WofostCropRates::DTSUME}, {"DTSUM", &WofostCropRates::DTSUM}, {"GLAIEX", &WofostCropRates::GLAIEX},
+	{"RR", &WofostCropRates::RR}, {"FYSDEL", &WofostCropRates::FYSDEL}
+};
+
+static const OutputVariable<WofostCrop> crop_output[] = {
+	{"EFF", &WofostCrop::EFF}, {"AMAX", &WofostCrop::AMAX}, {"PGASS", &WofostCrop::PGASS},
+	{"RFTRA", &WofostCrop::RFTRA}, {"TRANRF", &WofostCrop::TRANRF}, {"LASUM", &WofostCrop::LASUM},
+	{"KDIF", &WofostCrop::KDif}, {"TRAMX", &WofostCrop::TRAMX}, {"FR", &WofostCrop::Fr},
+	{"FL", &WofostCrop::Fl}, {"FS", &WofostCrop::Fs}, {"FO", &WofostCrop::Fo},
+	{"TRA", &WofostCrop::TRA}, {"TMINRA", &WofostCrop::TMINRA}, {"DSLV", &WofostCrop::DSLV},
+	{"SLAT", &WofostCrop::SLAT}, {"PMRES", &WofostCrop::PMRES}
+};
+
+static const OutputVariable<WofostSoil> soil_output[] = {
+	{"EVS", &WofostSoil::EVS}, {"EVW", &WofostSoil::EVW}, {"CR", &WofostSoil::CR},
+	{"DMAX", &WofostSoil::DMAX}, {"DZ", &WofostSoil::DZ}, {"RIN", &WofostSoil::RIN},
+	{"RIRR", &WofostSoil::RIRR}, {"DW", &WofostSoil::DW}, {"PERC", &WofostSoil::PERC},
+	{"LOSS", &WofostSoil::LOSS}, {"DWLOW", &WofostSoil::DWLOW}, {"SM", &WofostSoil::SM},
+	{"SS", &WofostSoil::ss}, {"W", &WofostSoil::W}, {"DSLR", &WofostSoil::DSLR},
+	{"WLOW", &WofostSoil::WLOW}, {"WWLOW", &WofostSoil::WWLOW}, {"RDM", &WofostSoil::RDM},
+	{"EVWMX", &WofostSoil::EVWMX}, {"EVSMX", &WofostSoil::EVSMX}, {"RTDF", &WofostSoil::RTDF},
+	{"ZT", &WofostSoil::ZT}, {"SUBAIR", &WofostSoil::SUBAIR}, {"WZ", &WofostSoil::WZ},
+	{"WE", &WofostSoil::WE}, {"PF", &WofostSoil::PF}
+};
+
+template <class C, size_t N>
+static bool find_output(const OutputVariable<C> (&vars)[N], const C &x, const std::string &name, const double* &v) {
+	for (size_t i=0; i<N; i++) {
+		if (name == vars[i].name) {
+			v = &(x.*vars[i].field);
+			return true;
+		}
+	}
+	return false;
+}
+
+// the address of output variable "name" in this model (NULL for "step");
+// false if there is no such variable
+bool WofostModel::output_variable(const std::string &name, const double* &v) {
+	v = NULL;
+	if (name == "step") return true;
+	return find_output(atm_output, atm, name, v) || find_output(crop_state_output, crop.s, name, v)
+		|| find_output(crop_rate_output, crop.r, name, v) || find_output(crop_output, crop, name, v)
+		|| find_output(soil_output, soil, name, v);
+}
+
+
+void WofostModel::model_output(bool incrop){
+	if (!summary) {
+		output.record(step);
+	} else if (incrop) {
+		season.LAIMAX = std::max(season.LAIMAX, crop.s.LAI);
+		season.TRA += crop.TRA;
+		season.TRAMX += crop.TRAMX;
+		season.EVS += soil.EVS;
+		season.EVW += soil.EVW;
+		if (crop.TRA < crop.TRAMX) season.stressdays++;
+		season.last = step;
+	}
+}
+
+
+// one row with the season summary; the crop variables are those at the
+// end of the run (all NAN if the run failed)
+void WofostModel::summary_output(){
+	if (fatalError) {
+		output.single(std::vector<double>(output.names.size(), NAN));
+		return;
 	}
+	double anthesis = crop.IDANTH >= 0 ? crop.emergence + crop.IDANTH : NAN;
+	double maturity = crop.s.DVS >= crop.p.DVSEND ? season.last : NAN;
+	output.single({double(crop.emergence), anthesis, maturity, season.LAIMAX,
+		season.TRA, season.TRAMX, season.TRA / season.TRAMX, season.EVS, season.EVW,
+		double(season.stressdays), crop.s.TAGP, crop.s.TWSO, crop.s.TWSO / crop.s.TAGP});
 }
 
 
 void WofostModel::initialize() {
 
 	fatalError = false;
+	// a run that fails here has no output (not that of the previous run)
+	output.clear();
+	summary = control.output_option == "SUMMARY";
+	season.reset();
+	// the names only change with the output option. They are set (and a
+	// SUMMARY output is started) before the checks below, so that a failed
+	// SUMMARY run has a row of NAN
+	if (output.names.empty() || (control.output_option != output.option)) {
+		if (control.output_option == "TEST") {
+			output.names = {"step", "ANGOT", "ATMTR", "COSLD", "DAYL", "DAYLP", "DIFPP",
+				"DSINBE", "SINLD", "EVWMX", "TSUM", "DVR", "DVS", "EVS", "LAI", "LASUM", "SAI", "PGASS", "RD", "SM", "FL", "FO", "FR", "FS", "PMRES", "TAGP",
+				"TRA", "TRAMX", "RFTRA", "WRT", "WLV", "WST", "WSO",
+				"TWRT", "TWLV", "TWST", "TWSO", "GRLV", "SLAT"};
+		} else if (control.output_option == "BATCH") {
+			output.names = {"WSO"};
+		} else if (control.output_option == "SUMMARY") {
+			output.names = {"emergence", "anthesis", "maturity", "LAIMAX", "TRA", "TRAMX", "WSI",
+				"EVS", "EVW", "stressdays", "TAGP", "TWSO", "HI"};
+		} else if ((control.output_option == "") || (control.output_option == "default")) {
+			output.names = {"step", "TSUM", "DVS", "LAI", "WRT", "WLV", "WST", "WSO", "TRA", "EVS", "EVW", "SM"};
+		} else {
+			// comma separated variable names
+			output.names.resize(0);
+			std::string name;
+			for (size_t i=0; i<=control.output_option.size(); i++) {
+				char c = i < control.output_option.size() ? control.output_option[i] : ',';
+				if (c == ',') {
+					if (!name.empty()) output.names.push_back(name);
+					name.clear();
+				} else if (c != ' ') {
+					name += c;
+				}
+			}
+		}
+		output.option = control.output_option;
+	}
+	if (summary) output.start(1);
+
 	if (wth.date.size() < 1) {
 		std::string m = "no weather data";
 	    messages.push_back(m);
@@ -114,11 +284,7 @@ void WofostModel::initialize() {
 	    fatalError = true;
 		return;
 	} else {
-		time=0;
-		// use find instead!
-		while (wth.date[time] < control.modelstart) {
-			time++;
-		}
+		time = date_index(wth.date, control.modelstart);
 	}
 
 	if (control.ISTCHO == 0) { // model starts at emergence)
@@ -137,19 +303,15 @@ void WofostModel::initialize() {
 
 //	ISTATE = 3;
 
-	if (control.output_option == "TEST") {
-		output.names = {"step", "ANGOT", "ATMTR", "COSLD", "DAYL", "DAYLP", "DIFPP",
-			"DSINBE", "SINLD", "EVWMX", "TSUM", "DVR", "DVS", "EVS", "LAI", "LASUM", "SAI", "PGASS", "RD", "SM", "FL", "FO", "FR", "FS", "PMRES", "TAGP",
-			"TRA", "TRAMX", "RFTRA", "WRT", "WLV", "WST", "WSO",
-			"TWRT", "TWLV", "TWST", "TWSO", "GRLV", "SLAT"};
-	} else if (control.output_option == "BATCH") {
-		output.names = {"WSO"};
-	} else {
-		output.names = {"step", "TSUM", "DVS", "LAI", "WRT", "WLV", "WST", "WSO", "TRA", "EVS", "EVW", "SM"};
+	output.vars.resize(summary ? 0 : output.names.size());
+	for (size_t j=0; j<output.vars.size(); j++) {
+		if (!output_variable(output.names[j], output.vars[j])) {
+			messages.push_back("unknown output variable: " + output.names[j]);
+			fatalError = true;
+		}
 	}
-
-	output.values.resize(0);
-	output.values.reserve(output.names.size() * 150);
+	// room for the crop season; grows if more rows are needed
+	if (!summary) output.start(std::max(control.IDURMX, 0) + control.cropstart + 1);
 
 	DOY = doy_from_days(wth.date[time]);
     crop.alive = true;
@@ -179,7 +341,7 @@ void WofostModel::initialize() {
     crop.s.WST = 0;
     crop.s.WSO = 0;
     crop.s.WLV = 0;
-    crop.LV[0] = 0;
+    crop.ILVOLD = 0;
     crop.LASUM = 0;
     crop.s.LAIEXP = 0;
     crop.s.LAI = 0;
@@ -190,25 +352,16 @@ void WofostModel::initialize() {
 	crop.s.TSUM = 0;
 	crop.s.TSUME = 0;
 	crop.r.DTSUME = 0;
+	crop.r.DVR = 0;
+	crop.r.RR = 0;
     crop.TRA = 0;
     crop.RFTRA = 0;
 	crop.r.GASS = 0;
 	crop.s.GRLV = 0;
 
 	// adjusting for CO2 effects
-    double CO2AMAXadj = AFGEN(crop.p.CO2AMAXTB, control.CO2);
-	for(size_t i=1; i<crop.p.AMAXTB.size(); i=i+2) {
-		crop.p.AMAXTB[i] = crop.p.AMAXTB[i] * CO2AMAXadj;
-	}
-    double CO2EFFadj = AFGEN(crop.p.CO2EFFTB, control.CO2);
-	for(size_t i=1; i<crop.p.CO2EFFTB.size(); i=i+2) {
-		crop.p.CO2EFFTB[i] = crop.p.CO2EFFTB[i] * CO2EFFadj;
-	}
-	double CO2TRAadj = AFGEN(crop.p.CO2TRATB, control.CO2);
-	for(size_t i=1; i<crop.p.CO2TRATB.size(); i=i+2) {
-		crop.p.CO2TRATB[i] = crop.p.CO2TRATB[i] * CO2TRAadj;
-	}
-
+	// (CO2EFFTB and CO2TRATB are not used yet)
+	crop.co2_tables(control.CO2);
 }
 
 void WofostModel::force_states() {
@@ -230,7 +383,8 @@ void WofostModel::force_states() {
 
 
 
-void WofostModel::run() {
+template <int W, bool OX>
+void WofostModel::simulate() {
 
 	step = 1;
 	//npk_step = 0;
@@ -250,12 +404,12 @@ void WofostModel::run() {
 
 	while (! crop_emerged) {
 		force_states();
-		weather_step();
+		weather_step<W, OX>();
 
 		//if(control.nutrient_limited){
 		//	npk_soil_dynamics_rates();
 		//} else{
-		soil_rates();
+		soil_rates<W>();
 		//}
 
 		//soil.EVWMX = atm.E0;
@@ -290,11 +444,11 @@ void WofostModel::run() {
 		}
 
 		if (!crop_emerged) {
-			model_output();
+			model_output(false);
 			//if(control.nutrient_limited){
 			//	npk_soil_dynamics_states();
 			//} else {
-				soil_states();
+				soil_states<W>();
 			//}
 			time++;
 			step++;
@@ -325,26 +479,27 @@ void WofostModel::run() {
 	while ((crop.alive) && (step < maxdur)) {
 		force_states();
 
-		if (! weather_step()) break;
+		if (! weather_step<W, OX>()) break;
 		crop_rates();
 		//if (!crop.alive) break;
 				
 		//if (control.nutrient_limited){
 		//	npk_soil_dynamics_rates();
 		//} else {
-			soil_rates();
+			soil_rates<W>();
 		//}
-		model_output();
+		model_output(true);
 		crop_states();
 		//if(control.nutrient_limited){
 		//	npk_soil_dynamics_states();
 		//} else {
-			soil_states();
+			soil_states<W>();
 		//}
 
 		time++;
 		step++;
 		if (fatalError) {
+			WATGW_report();
 			return;
 		}
 	}
@@ -353,19 +508,42 @@ void WofostModel::run() {
 		// should continue until maxdur if water balance if IENCHO is 1
 	    crop.TRA = 0;
 		while (step < maxdur) {
-			weather_step();
-			soil_rates();
+			weather_step<W, OX>();
+			soil_rates<W>();
 			// assuming that the crop has been harvested..
 			// not checked with fortran
 			soil.EVWMX = atm.E0;
 			soil.EVSMX = atm.ES0;
-			model_output();
+			model_output(false);
 			//crop_states();
-			soil_states();
+			soil_states<W>();
 			time++;
 			step++;
 		}
 	}
+	WATGW_report();
 }
 
 
+// the water balance and oxygen stress do not change during a run,
+// so the simulation loop is compiled for each combination
+void WofostModel::run() {
+	bool OX = control.IOXWL && !crop.p.IAIRDU;
+	if (!control.water_limited) {
+		simulate<WATBAL_PP, false>();
+	} else if (soil.p.IZT) {
+		if (OX) {
+			simulate<WATBAL_GW, true>();
+		} else {
+			simulate<WATBAL_GW, false>();
+		}
+	} else {
+		if (OX) {
+			simulate<WATBAL_FD, true>();
+		} else {
+			simulate<WATBAL_FD, false>();
+		}
+	}
+	if (summary) summary_output();
+	output.finish();
+}
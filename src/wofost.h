@@ -5,9 +5,13 @@ Author: Robert Hijmans
 License: GNU General Public License (GNU GPL) v. 2
 */
 
+#ifndef WOFOST_H_
+#define WOFOST_H_
+
 #include <vector>
 #include <string>
 #include "SimUtil.h"
+#include "subsol.h"
 
 class WofostWeather {
 public:
@@ -45,6 +49,9 @@ public:
 	//std::vector<double> N_amount, P_amount, K_amount;
 	//std::vector<long> NPKdates;
 	bool useForce = false;
+	// capillary flow: 0 computed with SUBSOL, 1 from a table of SUBSOL
+	// values, 2 from the table, reporting the maximum deviation from SUBSOL
+	int subsol_table = 0;
 };
 
 
@@ -132,7 +139,20 @@ public:
 	double TMINRA, DSLV, SLAT;
 	double PMRES;
 
-	std::vector<double> SLA = std::vector<double>(366), LV = std::vector<double>(366), LVAGE = std::vector<double>(366), TMNSAV = std::vector<double>(7);
+	// leaf classes in a ring buffer; class j (0 is the youngest) is at
+	// (LVHEAD + j) % LV.size(), ILVOLD is the number of classes
+	std::vector<double> SLA, LV, LVAGE;
+	size_t LVHEAD = 0;
+	// running sum of LV (WLV can be forced)
+	double LVSUM;
+	std::vector<double> TMNSAV = std::vector<double>(7);
+
+	// p.AMAXTB adjusted for CO2; p is not changed so that a model can be
+	// run again. Only recomputed if AMAXTB, CO2AMAXTB or CO2 changed
+	std::vector<double> AMAXTB;
+	void co2_tables(double CO2);
+	std::vector<double> tabAMAXTB, tabCO2AMAXTB;
+	double tabCO2 = NAN;
 
 	
 //04/2017 npk
@@ -229,11 +249,28 @@ public:
 	double RDM, EVWMX, EVSMX;
 	double SPAC, SPOC, WEXC, CAPRMX, SEEP, COSUT; 	// STDAY
 	double RTDF, MH0, MH1, ZT, SUBAIR, WZ, WZI, WE, WEDTOT, PF;
+	// maximum deviation of the tabulated capillary flow from SUBSOL
+	double FLOWDEV;
 
 	// summation  TSR, EVST, EVWT, WDRT, CRT, DRAINT, PERCT, LOSST
 	
 	std::vector<double> SDEFTB, DEFDTB, CAPRFU;
 
+	// groundwater tables (SDEFTB, DEFDTB, PFTAB) and the parameters
+	// derived from SMTAB and CONTAB; these only depend on the soil
+	// and are computed once
+	bool gwtables = false;
+	void groundwater_tables();
+	// capillary flow (SUBSOL) for this soil
+	SubsolTable FLOWTB;
+	void flow_table();
+	// computes the tables that are missing, or that were computed
+	// with another SMTAB or CONTAB (tabSMTAB, tabCONTAB)
+	void update_tables(bool flow);
+	// true if update_tables(flow) would not change anything
+	bool tables_current(bool flow) const;
+	std::vector<double> tabSMTAB, tabCONTAB;
+
 	/*
 	class ratesNPK {
 		double RNSOIL, RPSOIL, RKSOIL;
@@ -255,8 +292,12 @@ public:
 	virtual ~WofostSoilCollection(){}
 
 	std::vector<WofostSoil> soils;
-	size_t size() { return soils.size(); }
-	void push_back(WofostSoil s) { soils.push_back(s); }	
+	size_t size() const { return soils.size(); }
+	void push_back(WofostSoil s) { 
+		// the SUBSOL table is made when a run uses it (subsol_table)
+		if (s.p.IZT) s.update_tables(false);
+		soils.push_back(s); 
+	}	
 };
 
 class WofostAtmosphere {
@@ -278,14 +319,86 @@ public:
 };
 
 
+// receives the output rows of a run as they are produced
+class WofostOutputSink {
+public:
+	virtual ~WofostOutputSink(){}
+	virtual void start(const std::vector<std::string> &/*names*/) {}
+	virtual void row(const double *v, size_t n) = 0;
+	virtual void finish() {}
+};
+
+
+// columnar output; the variables are resolved once (in initialize) and
+// each day a row is written to the preallocated columns, or passed on
+// to the sink if there is one
 class WofostOutput {
 public:
 	virtual ~WofostOutput(){}
 	std::vector<std::string> names;
+	// the output option the names were made for
+	std::string option;
+	// column-major: the value of names[j] on row i is at [j * nrow + i]
+	// (after finish); empty if there is a sink
 	std::vector<double> values;
+	size_t nrow = 0;
+
+	// the recorded variables; NULL for the time step
+	std::vector<const double*> vars;
+	// not owned; NULL to keep the output in values
+	WofostOutputSink *sink = NULL;
+
+	void start(size_t rows);
+	void record(unsigned step) {
+		if (sink != NULL) {
+			for (size_t j=0; j<vars.size(); j++) {
+				rowvalues[j] = vars[j] == NULL ? double(step) : *vars[j];
+			}
+			sink->row(rowvalues.data(), rowvalues.size());
+			nrow++;
+			return;
+		}
+		if (nrow == cap) grow(2 * cap + 1);
+		double *v = values.data() + nrow;
+		for (size_t j=0; j<vars.size(); j++) {
+			v[j * cap] = vars[j] == NULL ? double(step) : *vars[j];
+		}
+		nrow++;
+	}
+	// a single row that is not made from vars (the season summary)
+	void single(const std::vector<double> &v);
+	// no rows (keeps the allocated memory)
+	void clear() {
+		nrow = cap = 0;
+		values.clear();
+	}
+	void finish();
+private:
+	size_t cap = 0;
+	std::vector<double> rowvalues;
+	void grow(size_t rows);
 };
 
 
+// season summary (output option "SUMMARY"), accumulated over the
+// days with a crop
+class WofostSummary {
+public:
+	virtual ~WofostSummary(){}
+	double LAIMAX, TRA, TRAMX, EVS, EVW;
+	// days with TRA < TRAMX, and the last day with a crop
+	unsigned stressdays, last;
+	void reset() {
+		LAIMAX = TRA = TRAMX = EVS = EVW = 0;
+		stressdays = last = 0;
+	}
+};
+
+
+// water balance of a run: potential production, freely draining soil,
+// or soil with groundwater
+enum {WATBAL_PP = 0, WATBAL_FD = 1, WATBAL_GW = 2};
+
 
 class WofostModel {
 public:
@@ -309,8 +422,11 @@ public:
 	void force_states();
 	
 	WofostOutput output;
+	bool summary = false;
+	WofostSummary season;
 	
-	bool weather_step();
+	// W is the water balance; OX is true if there is oxygen stress
+	template <int W, bool OX> bool weather_step();
 
 	void crop_initialize();
 	void crop_rates();
@@ -344,8 +460,8 @@ public:
 	//void maintanance_respiration();
 
 	void soil_initialize();
-	void soil_rates();
-	void soil_states();
+	template <int W> void soil_rates();
+	template <int W> void soil_states();
 
 	void WATFD_initialize();
 	void WATFD_rates();
@@ -358,6 +474,7 @@ public:
 	void WATGW_initialize();
 	void WATGW_rates();
 	void WATGW_states();
+	void WATGW_report();
 
 	void STDAY_initialize();
 	void STDAY();
@@ -369,18 +486,31 @@ public:
 	void ASTRO();
 	void PENMAN();
 	void PENMAN_MONTEITH();
-	void EVTRA();
+	template <bool WL, bool OX> void EVTRA();
 	double TOTASS();
 
 	void initialize();
 	void run();
-	void model_output();
+	template <int W, bool OX> void simulate();
+	void model_output(bool incrop);
+	void summary_output();
+	bool output_variable(const std::string &name, const double* &v);
 	
+	// the messages of the run (e.g. the SUBSOL deviation) are added to messages
 	std::vector<double> run_batch(std::vector<double> tmin, std::vector<double> tmax, 
 		std::vector<double> srad, std::vector<double> prec, std::vector<double> vapr, 
 		std::vector<double> wind, std::vector<long> date, std::vector<long> mstart, 
-		std::vector<int> soilindex, WofostSoilCollection soils, std::vector<double> depth,
+		std::vector<int> soilindex, const WofostSoilCollection &soils, std::vector<double> depth,
+		std::vector<double> elevation, std::vector<double> latitude);
+	// as run_batch, but in single precision. Yields can differ by a few
+	// percent if rounding moves a phenological stage by a day. Only
+	// compared with run_batch on synthetic runs, and therefore not in the
+	// R module (see tests/precision_tests.R for the PCSE test cases)
+	std::vector<double> run_batch_float(std::vector<double> tmin, std::vector<double> tmax, 
+		std::vector<double> srad, std::vector<double> prec, std::vector<double> vapr, 
+		std::vector<double> wind, std::vector<long> date, std::vector<long> mstart, 
+		std::vector<int> soilindex, const WofostSoilCollection &soils, std::vector<double> depth,
 		std::vector<double> elevation, std::vector<double> latitude);
 };
 
-
+#endif
@@ -12,36 +12,178 @@ using namespace Rcpp;
 #include "wofost.h"
 
 
-// [[Rcpp::export(".wofost")]]
-NumericMatrix wofost(List crop, DataFrame weather, List soil, List control) {
+// the (column-major) model output as a data.frame; the only copy
+// of the values is into the columns
+List outputDF(WofostModel* m) {
+	const WofostOutput &out = m->output;
+	size_t nc = out.names.size();
+	size_t nr = out.nrow;
+	if (out.values.size() < nr * nc) nr = 0;
+	List lst(nc);
+	for (size_t j = 0; j < nc; j++) {
+		std::vector<double>::const_iterator start = out.values.begin() + j * nr;
+		lst[j] = NumericVector(start, start + nr);
+	}
+	lst.attr("names") = wrap(out.names);
+	lst.attr("row.names") = IntegerVector::create(NA_INTEGER, -int(nr));
+	lst.attr("class") = "data.frame";
+	return lst;
+}
 
-// control ("timer") parameters
-	struct WofostControl cntr;
-	struct WofostCrop crp;
 
-	cntr.modelstart = valueFromList<long>(control, "modelstart");
-	cntr.cropstart = valueFromList<unsigned>(control, "cropstart");
-	
-	cntr.output_option = valueFromListDefault<std::string>(control, "output", "");
-	
-	cntr.latitude  = valueFromList<double>(control, "latitude");
-	cntr.elevation = valueFromList<double>(control, "elevation");
-	cntr.CO2 = valueFromListDefault<double>(control, "CO2", 360);
-	cntr.ANGSTA = valueFromListDefault<double>(control, "ANGSTA", 0.18);
-	cntr.ANGSTB = valueFromListDefault<double>(control, "ANGSTB", 0.55);
-	
-	cntr.water_limited = valueFromListDefault<bool>(control, "water_limited", false); 
-	//cntr.nutrient_limited = valueFromListDefault<bool>(control, "nutrient_limited", false); 
-	cntr.IOXWL = valueFromList<int>(control, "watlim_oxygen");
+// crop, soil and control parameters from named R lists. Missing required
+// parameters are reported together; optional parameters that are not in
+// the list keep their current value
+
+void cropFromList(List crop, WofostCropParameters &p) {
+	NamedList x(crop);
+	x.get("TBASEM", p.TBASEM);
+	x.get("TEFFMX", p.TEFFMX);
+	x.get("TSUMEM", p.TSUMEM);
+	x.get("IDSL", p.IDSL);
+	x.get("DLO", p.DLO);
+	x.get("DLC", p.DLC);
+	x.get("TSUM1", p.TSUM1);
+	x.get("TSUM2", p.TSUM2);
+	x.table("DTSMTB", p.DTSMTB);
+	x.optional("TCOLD1", p.TCOLD1);
+	x.optional("TCOLD2", p.TCOLD2);
+	x.get("TDWI", p.TDWI);
+	x.get("LAIEM", p.LAIEM);
+	x.get("RGRLAI", p.RGRLAI);
+	x.table("SLATB", p.SLATB);
+	x.get("SPA", p.SPA);
+	x.table("SSATB", p.SSATB);
+	x.get("SPAN", p.SPAN);
+	x.get("TBASE", p.TBASE);
+	x.get("CVL", p.CVL);
+	x.get("CVO", p.CVO);
+	x.get("CVR", p.CVR);
+	x.get("CVS", p.CVS);
+	x.get("Q10", p.Q10);
+	x.get("RML", p.RML);
+	x.get("RMO", p.RMO);
+	x.get("RMR", p.RMR);
+	x.get("RMS", p.RMS);
+	x.table("RFSETB", p.RFSETB);
+	x.table("FRTB", p.FRTB);
+	x.table("FLTB", p.FLTB);
+	x.table("FSTB", p.FSTB);
+	x.table("FOTB", p.FOTB);
+	x.get("PERDL", p.PERDL);
+	x.table("RDRRTB", p.RDRRTB);
+	x.table("RDRSTB", p.RDRSTB);
+	x.get("CFET", p.CFET);
+	x.get("DEPNR", p.DEPNR);
+	x.get("RDI", p.RDI);
+	x.get("RRI", p.RRI);
+	x.get("RDMCR", p.RDMCR);
+	// false (no airducts) if not given
+	p.IAIRDU = false;
+	x.optional("IAIRDU", p.IAIRDU);
+	x.table("KDIFTB", p.KDIFTB);
+	x.table("EFFTB", p.EFFTB);
+	x.table("AMAXTB", p.AMAXTB);
+	x.table("TMPFTB", p.TMPFTB);
+	x.table("TMNFTB", p.TMNFTB);
+	x.table("CO2AMAXTB", p.CO2AMAXTB);
+	x.table("CO2EFFTB", p.CO2EFFTB);
+	x.table("CO2TRATB", p.CO2TRATB);
+	x.check("crop");
+}
 
-	cntr.ISTCHO = valueFromList<int>(control, "start_sowing");
+
+void soilFromList(List soil, WofostSoilParameters &p) {
+	NamedList x(soil);
+	x.table("SMTAB", p.SMTAB);
+	x.get("SMW", p.SMW);
+	x.get("SMFCF", p.SMFCF);
+	x.get("SM0", p.SM0);
+	x.get("CRAIRC", p.CRAIRC);
+	x.table("CONTAB", p.CONTAB);
+	x.get("K0", p.K0);
+	x.get("SOPE", p.SOPE);
+	x.get("KSUB", p.KSUB);
+	//soil variables that used to be in the control object
+	x.get("IZT", p.IZT);  // groundwater present
+	x.get("IFUNRN", p.IFUNRN);
+	x.get("WAV", p.WAV);
+	x.get("ZTI", p.ZTI);
+	x.get("DD", p.DD);
+	x.get("RDMSOL", p.RDMSOL);
+	x.get("IDRAIN", p.IDRAIN); // presence of drains
+	x.get("NOTINF", p.NOTINF); // fraction not inflitrating rainfall
+	x.get("SSMAX", p.SSMAX); // max surface storage
+	x.get("SMLIM", p.SMLIM);
+	x.get("SSI", p.SSI);
+	x.check("soil");
+}
+
+
+void controlFromList(List control, WofostControl &cntr) {
+	NamedList x(control);
+	x.get("modelstart", cntr.modelstart);
+	x.get("cropstart", cntr.cropstart);
+	// a vector of output variable names is collapsed to "name1,name2"
+	SEXP out = x.find("output");
+	if (out != R_NilValue) {
+		CharacterVector v(out);
+		std::string s;
+		for (R_xlen_t i=0; i<v.size(); i++) {
+			if (i > 0) s += ",";
+			s += std::string(v[i]);
+		}
+		cntr.output_option = s;
+	}
+	x.get("latitude", cntr.latitude);
+	x.get("elevation", cntr.elevation);
+	x.optional("CO2", cntr.CO2);
+	x.optional("ANGSTA", cntr.ANGSTA);
+	x.optional("ANGSTB", cntr.ANGSTB);
+	x.optional("water_limited", cntr.water_limited);
+	//cntr.nutrient_limited = valueFromListDefault<bool>(control, "nutrient_limited", false); 
+	x.get("watlim_oxygen", cntr.IOXWL);
+	x.optional("cold_limited", cntr.cold_limited);
+	x.get("start_sowing", cntr.ISTCHO);
 	//cntr.IDESOW = valueFromList<int>(control, "IDESOW");
 	//cntr.IDLSOW = valueFromList<int>(control, "IDLSOW");
-
 	//cntr.IENCHO = valueFromList<int>(control, "IENCHO");
 	//cntr.IDAYEN = valueFromList<int>(control, "IDAYEN");
-	cntr.IDURMX = valueFromList<int>(control, "max_duration");
-	cntr.stop_maturity = valueFromList<int>(control, "stop_maturity");
+	x.get("max_duration", cntr.IDURMX);
+	x.optional("subsol_table", cntr.subsol_table);
+	x.optional("stop_maturity", cntr.stop_maturity);
+	x.check("control");
+	//npk
+}
+
+
+// set all parameters at once from an R list (methods of the Rcpp module)
+void setCrop(WofostModel* m, List crop) {
+	cropFromList(crop, m->crop.p);
+}
+
+void setSoil(WofostModel* m, List soil) {
+	soilFromList(soil, m->soil.p);
+}
+
+void setSoilParameters(WofostSoil* s, List soil) {
+	soilFromList(soil, s->p);
+}
+
+void setControl(WofostModel* m, List control) {
+	controlFromList(control, m->control);
+}
+
+
+// [[Rcpp::export(".wofost")]]
+List wofost(List crop, DataFrame weather, List soil, List control) {
+
+	WofostControl cntr;
+	WofostCrop crp;
+	WofostSoil sol;
+	controlFromList(control, cntr);
+	cropFromList(crop, crp.p);
+	soilFromList(soil, sol.p);
 	//npk
 	/*
 	cntr.npk_model = valueFromListDefault<int>(control, "npk_model", false);
@@ -85,101 +227,6 @@ NumericMatrix wofost(List crop, DataFrame weather, List soil, List control) {
 		crp.pn.KMAXLV_TB = TableFromList(crop, "KMAXLV_TB");
 	}
 	*/
-	
-	crp.p.TBASEM = valueFromList<double>(crop, "TBASEM");
-	crp.p.TEFFMX = valueFromList<double>(crop, "TEFFMX");
-	crp.p.TSUMEM = valueFromList<double>(crop, "TSUMEM");
-	crp.p.IDSL = valueFromList<int>(crop, "IDSL");
-	crp.p.DLO = valueFromList<double>(crop, "DLO");
-	crp.p.DLC = valueFromList<double>(crop, "DLC");
-	crp.p.TSUM1 = valueFromList<double>(crop, "TSUM1");
-	crp.p.TSUM2 = valueFromList<double>(crop, "TSUM2");
-	crp.p.DTSMTB = TableFromList(crop, "DTSMTB");
-	//crp.p.DVSI = valueFromList<double>(crop, "DVSI");
-	//crp.p.DVSEND = valueFromList<double>(crop, "DVSEND");
-	crp.p.TDWI = valueFromList<double>(crop, "TDWI");
-	crp.p.LAIEM = valueFromList<double>(crop, "LAIEM");
-	crp.p.RGRLAI = valueFromList<double>(crop, "RGRLAI");
-	crp.p.SLATB = TableFromList(crop, "SLATB");
-	crp.p.SPA = valueFromList<double>(crop, "SPA");
-	crp.p.SSATB = TableFromList(crop, "SSATB");
-	crp.p.SPAN = valueFromList<double>(crop, "SPAN");
-	crp.p.TBASE = valueFromList<double>(crop, "TBASE");
-	crp.p.CVL = valueFromList<double>(crop, "CVL");
-	crp.p.CVO = valueFromList<double>(crop, "CVO");
-	crp.p.CVR = valueFromList<double>(crop, "CVR");
-	crp.p.CVS = valueFromList<double>(crop, "CVS");
-	crp.p.Q10 = valueFromList<double>(crop, "Q10");
-	crp.p.RML = valueFromList<double>(crop, "RML");
-	crp.p.RMO = valueFromList<double>(crop, "RMO");
-	crp.p.RMR = valueFromList<double>(crop, "RMR");
-	crp.p.RMS = valueFromList<double>(crop, "RMS");
-	crp.p.RFSETB = TableFromList(crop, "RFSETB");
-	crp.p.FRTB = TableFromList(crop, "FRTB");
-	crp.p.FLTB = TableFromList(crop, "FLTB");
-	crp.p.FSTB = TableFromList(crop, "FSTB");
-	crp.p.FOTB = TableFromList(crop, "FOTB");
-	crp.p.PERDL = valueFromList<double>(crop, "PERDL");
-	crp.p.RDRRTB = TableFromList(crop, "RDRRTB");
-	crp.p.RDRSTB = TableFromList(crop, "RDRSTB");
-	crp.p.CFET = valueFromList<double>(crop, "CFET");
-	crp.p.DEPNR = valueFromList<double>(crop, "DEPNR");
-	crp.p.RDI = valueFromList<double>(crop, "RDI");
-	crp.p.RRI = valueFromList<double>(crop, "RRI");
-	crp.p.RDMCR = valueFromList<double>(crop, "RDMCR");
-
-	crp.p.IAIRDU = valueFromList<int>(crop, "IAIRDU");
-
-	crp.p.KDIFTB = TableFromList(crop, "KDIFTB");
-	crp.p.EFFTB = TableFromList(crop, "EFFTB");
-	crp.p.AMAXTB = TableFromList(crop, "AMAXTB");
-	crp.p.TMPFTB = TableFromList(crop, "TMPFTB");
-	crp.p.TMNFTB = TableFromList(crop, "TMNFTB");
-
-	crp.p.CO2AMAXTB = TableFromList(crop, "CO2AMAXTB");
-	crp.p.CO2EFFTB = TableFromList(crop, "CO2EFFTB");
-	crp.p.CO2TRATB = TableFromList(crop, "CO2TRATB");
-
-
-// soil parameters
-	struct WofostSoil sol;
-
-	//if (cntr.IOXWL != 0) {
-	
-	sol.p.SMTAB = TableFromList(soil, "SMTAB");
-	
-	//} else { // should be no need to read it; need to check if true
-	//	sol.p.SMTAB = TableFromList(soil, "SMTAB");
-	//}
-	sol.p.SMW = valueFromList<double>(soil, "SMW");
-	sol.p.SMFCF = valueFromList<double>(soil, "SMFCF");
-	sol.p.SM0 = valueFromList<double>(soil, "SM0");
-	sol.p.CRAIRC = valueFromList<double>(soil, "CRAIRC");
-	sol.p.CONTAB = TableFromList(soil, "CONTAB");
-	sol.p.K0 = valueFromList<double>(soil, "K0");
-	sol.p.SOPE = valueFromList<double>(soil, "SOPE");
-	sol.p.KSUB = valueFromList<double>(soil, "KSUB");
-	//sol.p.SPADS = valueFromList<double>(soil, "SPADS");
-	//sol.p.SPASS = valueFromList<double>(soil, "SPASS");
-	//sol.p.SPODS = valueFromList<double>(soil, "SPODS");
-	//sol.p.SPOSS = valueFromList<double>(soil, "SPOSS");
-	//sol.p.DEFLIM = valueFromList<double>(soil, "DEFLIM");
-
-
-	//soil variables that used to be in the control object
-	sol.p.IZT = valueFromList<int>(soil, "IZT");  // groundwater present
-	sol.p.IFUNRN = valueFromList<int>(soil, "IFUNRN");
-	sol.p.WAV = valueFromList<double>(soil, "WAV");
-	sol.p.ZTI = valueFromList<double>(soil, "ZTI");
-	sol.p.DD = valueFromList<double>(soil, "DD");
-	sol.p.RDMSOL = valueFromList<double>(soil, "RDMSOL");
-
-	sol.p.IDRAIN = valueFromList<int>(soil, "IDRAIN"); // presence of drains
-	sol.p.NOTINF = valueFromList<int>(soil, "NOTINF"); // fraction not inflitrating rainfall
-	sol.p.SSMAX = valueFromList<double>(soil, "SSMAX"); // max surface storage
-	sol.p.SMLIM = valueFromList<double>(soil, "SMLIM");
-	sol.p.SSI = valueFromList<double>(soil, "SSI");
-
 	/*
 	if(cntr.npk_model){
 		sol.pn.N_recovery = vectorFromList<double>(control, "Nrecovery");
@@ -225,20 +272,180 @@ NumericMatrix wofost(List crop, DataFrame weather, List soil, List control) {
 		}
 	}
 
-	size_t nc = m.output.names.size();
-	size_t nr = m.output.values.size() / nc;
-	NumericMatrix mat(nr, nc);
-	CharacterVector cnames = wrap(m.output.names);
-	colnames(mat) = cnames;
+	return outputDF(&m);
+}
+
+
+
+// element i of a control parameter that varies by site
+SEXP siteElement(SEXP v, R_xlen_t i) {
+	switch (TYPEOF(v)) {
+		case REALSXP: return NumericVector::create(REAL(v)[i]);
+		case INTSXP: return IntegerVector::create(INTEGER(v)[i]);
+		case LGLSXP: return LogicalVector::create(LOGICAL(v)[i]);
+		case STRSXP: return CharacterVector::create(STRING_ELT(v, i));
+		default: stop("unsupported control parameter type");
+	}
+	return R_NilValue;
+}
+
+// the output of one site
+class SiteRun {
+public:
+	std::vector<double> values;
+	size_t nrow = 0;
+	std::vector<std::string> names, messages;
+	bool fatalError = false;
+	// an exception in the thread
+	std::string error;
+};
+
+
+// Run the model for n sites (a list of n weather data.frames). crops and
+// soils are lists of 1 or n parameter lists; these are converted once.
+// control parameters of length n vary by site ("output" is the same for
+// all sites). The sites are run on 'threads' threads (0 for all cores).
+// The output of all sites is returned in one data.frame with a "site"
+// column (1 to n), and the messages of the sites in attribute "messages"
+
+// [[Rcpp::export(".wofost_sites")]]
+List wofost_sites(List crops, List weather, List soils, List control, int threads) {
+
+	size_t n = weather.size();
+	if ((crops.size() != 1) && (size_t(crops.size()) != n)) stop("the number of crops must be 1 or the number of sites");
+	if ((soils.size() != 1) && (size_t(soils.size()) != n)) stop("the number of soils must be 1 or the number of sites");
+
+	std::vector<WofostCrop> crp(crops.size());
+	for (size_t i=0; i<crp.size(); i++) {
+		cropFromList(crops[i], crp[i].p);
+	}
+	WofostSoilCollection sol;
+	for (R_xlen_t i=0; i<soils.size(); i++) {
+		WofostSoil s;
+		soilFromList(soils[i], s.p);
+		sol.push_back(s);
+	}
+
+	std::vector<WofostControl> cntr(n);
+	CharacterVector cnms = control.names();
+	for (size_t i=0; i<n; i++) {
+		List row(control.size());
+		for (R_xlen_t k=0; k<control.size(); k++) {
+			SEXP v = control[k];
+			if ((n > 1) && (size_t(Rf_xlength(v)) == n) && (std::string(cnms[k]) != "output")) {
+				row[k] = siteElement(v, i);
+			} else {
+				row[k] = v;
+			}
+		}
+		row.attr("names") = cnms;
+		controlFromList(row, cntr[i]);
+	}
+	// the groundwater (and SUBSOL) tables are made once for each soil,
+	// not for each site in WATGW_initialize
+	bool flow = false;
+	for (size_t i=0; i<n; i++) flow = flow || (cntr[i].subsol_table > 0);
+	for (size_t j=0; j<sol.size(); j++) {
+		if (sol.soils[j].p.IZT) sol.soils[j].update_tables(flow);
+	}
+
+	std::vector<WofostWeather> wth(n);
+	for (size_t i=0; i<n; i++) {
+		DataFrame w = weather[i];
+		wth[i].tmin = vectorFromDF<double>(w, "tmin");
+		wth[i].tmax = vectorFromDF<double>(w, "tmax");
+		wth[i].srad = vectorFromDF<double>(w, "srad");
+		wth[i].prec = vectorFromDF<double>(w, "prec");
+		wth[i].vapr = vectorFromDF<double>(w, "vapr");
+		wth[i].wind = vectorFromDF<double>(w, "wind");
+		wth[i].date = vectorFromDF<long>(w, "date");
+	}
 
-	size_t k=0;
-	for (size_t i = 0; i < nr; i++) {
-		for (size_t j = 0; j < nc; j++) {
-			mat(i, j) = m.output.values[k];
-			k++;
+	// no R objects are used from here
+	std::vector<SiteRun> runs(n);
+	// an exception (e.g. out of memory) must not leave a thread; it is
+	// reported with stop() after all threads are done
+	parallelFor(n, std::max(threads, 0), [&](size_t i) {
+		SiteRun &r = runs[i];
+		try {
+			WofostModel m;
+			m.crop = crp[crp.size() > 1 ? i : 0];
+			m.soil = sol.soils[sol.size() > 1 ? i : 0];
+			m.control = cntr[i];
+			m.wth.date.swap(wth[i].date);
+			m.wth.tmin.swap(wth[i].tmin);
+			m.wth.tmax.swap(wth[i].tmax);
+			m.wth.srad.swap(wth[i].srad);
+			m.wth.prec.swap(wth[i].prec);
+			m.wth.vapr.swap(wth[i].vapr);
+			m.wth.wind.swap(wth[i].wind);
+			m.run();
+			r.values.swap(m.output.values);
+			r.nrow = m.output.nrow;
+			r.names.swap(m.output.names);
+			r.messages.swap(m.messages);
+			r.fatalError = m.fatalError;
+		} catch (std::exception &e) {
+			r.error = e.what();
+		} catch (...) {
+			r.error = "unknown error";
+		}
+	});
+	for (size_t i=0; i<n; i++) {
+		if (!runs[i].error.empty()) {
+			stop("site " + std::to_string(i+1) + ": " + runs[i].error);
 		}
 	}
 
-	return(mat);
-}
+	// sites without output (e.g. no weather data) have no rows
+	std::vector<std::string> names;
+	size_t nr = 0;
+	for (size_t i=0; i<n; i++) {
+		if (names.empty()) names = runs[i].names;
+	}
+	// sites with other output variables are not included
+	std::vector<char> dropped(n, 0);
+	for (size_t i=0; i<n; i++) {
+		SiteRun &r = runs[i];
+		if ((r.nrow > 0) && ((r.names != names) || (r.values.size() < r.nrow * names.size()))) {
+			r.nrow = 0;
+			dropped[i] = 1;
+		}
+		nr += r.nrow;
+	}
+	// the messages of all sites, for the R function to report (as run does)
+	std::vector<std::string> msgs;
+	for (size_t i=0; i<n; i++) {
+		const SiteRun &r = runs[i];
+		for (size_t j = 0; j < r.messages.size(); j++) {
+			msgs.push_back("site " + std::to_string(i+1) + ": " + (r.fatalError && (j == r.messages.size()-1) ? "Error : " : "") + r.messages[j]);
+		}
+		if (dropped[i]) {
+			msgs.push_back("site " + std::to_string(i+1) + ": the output variables differ from those of the other sites; the site is not included");
+		}
+	}
 
+	size_t nc = names.size();
+	List lst(nc + 1);
+	IntegerVector site(nr);
+	for (size_t i=0, k=0; i<n; i++) {
+		for (size_t j=0; j<runs[i].nrow; j++) site[k++] = i + 1;
+	}
+	size_t col = 0;
+	lst[col++] = site;
+	for (size_t j=0; j<nc; j++) {
+		NumericVector v(nr);
+		double *d = v.begin();
+		for (size_t i=0; i<n; i++) {
+			const SiteRun &r = runs[i];
+			d = std::copy(r.values.begin() + j * r.nrow, r.values.begin() + (j + 1) * r.nrow, d);
+		}
+		lst[col++] = v;
+	}
+	names.insert(names.begin(), "site");
+	lst.attr("names") = wrap(names);
+	lst.attr("row.names") = IntegerVector::create(NA_INTEGER, -int(nr));
+	lst.attr("class") = "data.frame";
+	if (!msgs.empty()) lst.attr("messages") = wrap(msgs);
+	return lst;
+}
@@ -0,0 +1,1332 @@
+/*
+Author: Robert Hijmans
+2026
+
+License: GNU General Public License (GNU GPL) v. 2
+
+Lockstep simulation of many cells. The computations are those of
+WofostModel (cropsi.cpp, astro.cpp, penman.cpp, evtra.cpp, rootd.cpp,
+watpp.cpp, watfd.cpp, watgw.cpp), with the scalar states replaced
+by arrays over the lanes. See these files for documentation.
+*/
+
+#include <cmath>
+#include <vector>
+#include <string>
+#include "wofost_batch.h"
+#include "subsol.h"
+#include "SimUtil.h"
+
+// infiltration table for a freely draining soil (as in WATFD_initialize)
+static const std::vector<double> NINFTB_FD = {0.0, 0.0, 0.5, 0.0, 1.5, 1.0, 0.0, 0.0};
+
+double ASSIM(double AMAX, double EFF, double LAI, double KDif, double SINB, double PARDIR, double PARDif);
+double SWEAF(double ET0, double CGNR);
+double SatVapourPressure(double temp);
+double Celsius2Kelvin(double temp);
+
+
+template <class T>
+std::vector<std::vector<T>*> WofostBatchAtmosphere<T>::fields() {
+	return {&RAIN, &AVRAD, &TEMP, &DTEMP, &TMIN, &TMAX, &E0, &ES0, &ET0, &DAYL, &DAYLP, &WIND, &VAP,
+			&SINLD, &COSLD, &DSINB, &DSINBE, &DifPP, &ATMTR, &ANGOT, &latitude, &elevation};
+}
+
+template <class T>
+void WofostBatchAtmosphere<T>::resize(size_t n) {
+	DOY.resize(n);
+	for (std::vector<T>* v : fields()) v->resize(n);
+}
+
+template <class T>
+void WofostBatchAtmosphere<T>::copy(size_t to, size_t from) {
+	DOY[to] = DOY[from];
+	for (std::vector<T>* v : fields()) (*v)[to] = (*v)[from];
+}
+
+
+template <class T>
+std::vector<std::vector<T>*> WofostBatchCrop<T>::fields() {
+	return {&RD, &RDOLD, &GRLV, &DWRT, &DWLV, &DWST, &DWSO,
+			&DVS, &LAI, &LAIEXP, &SAI, &PAI, &WRT, &WLV, &WST, &WSO,
+			&TWRT, &TWLV, &TWST, &TWSO, &TAGP, &TSUM, &TSUME, &TADW,
+			&GASS, &GWST, &GWSO, &DRST, &DRLV, &DRRT, &GWRT, &DRSO,
+			&DVR, &DTSUME, &DTSUM, &GLAIEX, &RR, &FYSDEL,
+			&EFF, &AMAX, &PGASS, &RFTRA, &TRANRF, &LASUM, &KDif, &TRAMX,
+			&Fr, &Fl, &Fs, &Fo, &TRA, &TMINRA, &DSLV, &SLAT, &PMRES};
+}
+
+template <class T>
+void WofostBatchCrop<T>::resize(size_t n, size_t classes) {
+	for (std::vector<T>* v : fields()) v->resize(n);
+	alive.resize(n);
+	IDANTH.resize(n);
+	TMNSAV.resize(n * 7);
+	nclass = classes;
+	LV.resize(n * classes);
+	SLA.resize(n * classes);
+	LVAGE.resize(n * classes);
+	LVOLD.resize(n);
+	LVNEW.resize(n);
+}
+
+template <class T>
+void WofostBatchCrop<T>::copy(size_t to, size_t from) {
+	for (std::vector<T>* v : fields()) (*v)[to] = (*v)[from];
+	alive[to] = alive[from];
+	IDANTH[to] = IDANTH[from];
+	std::copy(TMNSAV.begin() + from*7, TMNSAV.begin() + (from+1)*7, TMNSAV.begin() + to*7);
+	// only the living leaf classes
+	size_t a = from * nclass, b = to * nclass;
+	for (size_t k = LVOLD[from]; k <= LVNEW[from]; k++) {
+		LV[b+k] = LV[a+k];
+		SLA[b+k] = SLA[a+k];
+		LVAGE[b+k] = LVAGE[a+k];
+	}
+	LVOLD[to] = LVOLD[from];
+	LVNEW[to] = LVNEW[from];
+}
+
+
+template <class T>
+std::vector<std::vector<T>*> WofostBatchSoil<T>::fields() {
+	return {&EVS, &EVW, &CR, &DMAX, &DZ,
+			&RIN, &RINold, &RIRR, &DW, &PERC, &LOSS, &DWLOW,
+			&SM, &ss, &W, &WI, &DSLR, &WLOW, &WLOWI, &WWLOW,
+			&RDM, &EVWMX, &EVSMX, &RTDF, &ZT, &SUBAIR, &WZ, &WZI, &WE, &WEDTOT, &PF};
+}
+
+template <class T>
+void WofostBatchSoil<T>::resize(size_t n) {
+	sidx.resize(n);
+	for (std::vector<T>* v : fields()) v->resize(n);
+}
+
+template <class T>
+void WofostBatchSoil<T>::copy(size_t to, size_t from) {
+	sidx[to] = sidx[from];
+	for (std::vector<T>* v : fields()) (*v)[to] = (*v)[from];
+}
+
+
+template <class T>
+bool WofostBatchModelT<T>::prepare() {
+
+	if ((control.ISTCHO != 0) && (control.ISTCHO != 1)) {
+		messages.push_back("start_sowing (ISTCHO) must be 0 or 1");
+		fatalError = true;
+		return false;
+	}
+	if ((soils == NULL) || (soils->size() == 0)) {
+		messages.push_back("no soil data");
+		fatalError = true;
+		return false;
+	}
+
+	// parameter adjustments that WofostModel makes when initializing the
+	// water balance. The soils are used from the collection; only a soil
+	// that is changed by these adjustments is copied (to changed)
+	bool flow = control.subsol_table > 0;
+	psoils.resize(soils->size());
+	changed.clear();
+	changed.reserve(soils->size());
+	for (size_t j=0; j<psoils.size(); j++) {
+		const WofostSoil &s = soils->soils[j];
+		psoils[j] = &s;
+		if (!control.water_limited) continue;
+		if (s.p.IZT) {
+			// normally done when the soil was added to the collection
+			if (s.tables_current(flow)) continue;
+			changed.push_back(s);
+			changed.back().update_tables(flow);
+		} else {
+			double SMLIM = std::min(std::max(s.p.SMLIM, s.p.SMW), s.p.SM0);
+			if (crop.p.IAIRDU) SMLIM = s.p.SM0;
+			if ((SMLIM == s.p.SMLIM) && (s.p.NINFTB == NINFTB_FD)) continue;
+			changed.push_back(s);
+			changed.back().p.SMLIM = SMLIM;
+			changed.back().p.NINFTB = NINFTB_FD;
+		}
+		psoils[j] = &changed.back();
+	}
+
+	// adjusting for CO2 effects
+	crop.co2_tables(control.CO2);
+	return true;
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::lane_initialize(size_t i, size_t k) {
+
+	size_t c = jobs[k].cell;
+	job[i] = k;
+	cell[i] = c;
+	time[i] = jobs[k].start;
+	step[i] = 1;
+	cropstart_step[i] = 1 + control.cropstart;
+	ISTATE[i] = control.ISTCHO == 1 ? 1 : 3;
+	phase[i] = LANE_SOIL;
+	fatal[i] = false;
+	yield[i] = NAN;
+
+	latm.latitude[i] = latitude[c];
+	latm.elevation[i] = elevation[c];
+	// a cell with an impossible latitude gets NAN (no data). WofostModel
+	// runs with a fatal error instead, and usually returns 0
+	if (latitude[c] > 90 || latitude[c] < -90) {
+		phase[i] = LANE_DONE;
+		return;
+	}
+
+	size_t s = soilindex[c];
+	lsoil.sidx[i] = s;
+	const WofostSoilParameters &sp = psoils[s]->p;
+	double RDMSOL = sp.RDMSOL, ZTI = sp.ZTI, WAV = sp.WAV;
+	if (!overlay.empty()) {
+		const WofostSoilOverlay &o = overlay[c];
+		if (o.RDMSOL >= 0) RDMSOL = o.RDMSOL;
+		if (o.ZTI >= 0) ZTI = o.ZTI;
+		if (o.WAV >= 0) WAV = o.WAV;
+	}
+
+	// crop
+	lcrop.DVS[i] = ISTATE[i] == 1 ? -0.1 : 0;
+	lcrop.alive[i] = true;
+	lcrop.WRT[i] = 0;
+	lcrop.TADW[i] = 0;
+	lcrop.WST[i] = 0;
+	lcrop.WSO[i] = 0;
+	lcrop.WLV[i] = 0;
+	lcrop.LASUM[i] = 0;
+	lcrop.LAIEXP[i] = 0;
+	lcrop.LAI[i] = 0;
+	lcrop.KDif[i] = 0;
+	lcrop.SAI[i] = 0;
+	lcrop.PAI[i] = 0;
+	lcrop.RD[i] = crop.p.RDI;
+	lcrop.TSUM[i] = 0;
+	lcrop.TSUME[i] = 0;
+	lcrop.DTSUME[i] = 0;
+	lcrop.DVR[i] = 0;
+	lcrop.RR[i] = 0;
+	lcrop.TRA[i] = 0;
+	lcrop.RFTRA[i] = 0;
+	lcrop.GASS[i] = 0;
+	lcrop.GRLV[i] = 0;
+
+	// ROOTD_initialize
+	lsoil.RDM[i] = std::max<T>(crop.p.RDI, std::min<T>(RDMSOL, crop.p.RDMCR));
+	lsoil.ZT[i] = sp.IZT ? ZTI : 999.;
+
+	// water balance
+	lsoil.EVS[i] = 0;
+	lsoil.EVW[i] = 0;
+	T RD = lcrop.RD[i];
+	if (!control.water_limited) {
+		lsoil.SM[i] = sp.SMFCF;
+
+	} else if (!sp.IZT) {
+		lcrop.RDOLD[i] = RD;
+		lsoil.ss[i] = sp.SSI;
+		lsoil.SM[i] = LIMIT(sp.SMW, sp.SMLIM, sp.SMW + WAV / RD);
+		lsoil.W[i] = lsoil.SM[i] * RD;
+		lsoil.WI[i] = lsoil.W[i];
+		lsoil.DSLR[i] = 1.;
+		if (lsoil.SM[i] <= (sp.SMW + 0.5 * (sp.SMFCF - sp.SMW))) lsoil.DSLR[i] = 5.;
+		T RDM = lsoil.RDM[i];
+		lsoil.WLOW[i] = LIMIT(0., sp.SM0 * (RDM - RD), WAV + RDM * sp.SMW - lsoil.W[i]);
+		lsoil.WLOWI[i] = lsoil.WLOW[i];
+		lsoil.WWLOW[i] = lsoil.W[i] + lsoil.WLOW[i];
+		lsoil.RIN[i] = 0.;
+		lsoil.RINold[i] = 0.;
+		lsoil.RIRR[i] = 0.;
+		lsoil.DW[i] = 0.;
+		lsoil.PERC[i] = 0.;
+		lsoil.LOSS[i] = 0.;
+		lsoil.DWLOW[i] = 0.;
+
+	} else {
+		const std::vector<double> &SDEFTB = psoils[s]->SDEFTB;
+		T XDEF = 1000.;
+		lsoil.RTDF[i] = 0.;
+		lcrop.RDOLD[i] = RD;
+		lsoil.ss[i] = sp.SSI;
+		T ZT = LIMIT(0.1, XDEF, ZTI);
+		if (sp.IDRAIN == 1) {
+			ZT = std::max<T>(ZT, sp.DD);
+		}
+		lsoil.ZT[i] = ZT;
+		lsoil.SUBAIR[i] = AFGENLOG2(SDEFTB, ZT - RD);
+		lsoil.WZ[i] = (XDEF - RD) * sp.SM0 - lsoil.SUBAIR[i];
+		lsoil.WZI[i] = lsoil.WZ[i];
+		lsoil.WE[i] = sp.SM0 * RD + lsoil.SUBAIR[i] - AFGENLOG2(SDEFTB, ZT);
+		lsoil.WEDTOT[i] = sp.SM0 * sp.DD - AFGENLOG2(SDEFTB, sp.DD);
+		if (ZT < RD + 100.) {
+			lsoil.W[i] = lsoil.WE[i];
+		} else {
+			lsoil.W[i] = sp.SMFCF * RD;
+		}
+		lsoil.SM[i] = lsoil.W[i] / RD;
+		lsoil.WI[i] = lsoil.W[i];
+		lsoil.DSLR[i] = 1.;
+		if (lsoil.SM[i] <= AFGEN(sp.SMTAB, 3.0)) {
+			lsoil.DSLR[i] = 5.;
+		}
+		lsoil.RIN[i] = 0.;
+		lsoil.RIRR[i] = 0.;
+		lsoil.DW[i] = 0.;
+		lsoil.PERC[i] = 0.;
+		lsoil.CR[i] = 0.;
+		lsoil.DMAX[i] = 0.;
+		lsoil.DZ[i] = 0.;
+	}
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::crop_initialize(size_t i) {
+	lcrop.IDANTH[i] = -99;
+	T DVS = crop.p.DVSI;
+	lcrop.DVS[i] = DVS;
+	lcrop.TSUM[i] = 0;
+	lcrop.Fr[i] = AFGEN(crop.p.FRTB, DVS);
+	lcrop.Fl[i] = AFGEN(crop.p.FLTB, DVS);
+	lcrop.Fs[i] = AFGEN(crop.p.FSTB, DVS);
+	lcrop.Fo[i] = AFGEN(crop.p.FOTB, DVS);
+
+	size_t o = i * lcrop.nclass;
+	lcrop.SLA[o] = AFGEN(crop.p.SLATB, DVS);
+	lcrop.LVAGE[o] = 0.;
+	lcrop.LVOLD[i] = 0;
+	lcrop.LVNEW[i] = 0;
+
+	lcrop.DWRT[i] = 0;
+	lcrop.DWLV[i] = 0;
+	lcrop.DWST[i] = 0;
+	lcrop.DWSO[i] = 0;
+
+	lcrop.WRT[i] = lcrop.Fr[i] * crop.p.TDWI;
+	lcrop.TADW[i] = (1. - lcrop.Fr[i]) * crop.p.TDWI;
+	lcrop.WST[i] = lcrop.Fs[i] * lcrop.TADW[i];
+	lcrop.WSO[i] = lcrop.Fo[i] * lcrop.TADW[i];
+	lcrop.WLV[i] = lcrop.Fl[i] * lcrop.TADW[i];
+
+	lcrop.TWRT[i] = lcrop.WRT[i];
+	lcrop.TWLV[i] = lcrop.WLV[i];
+	lcrop.TWST[i] = lcrop.WST[i];
+	lcrop.TWSO[i] = lcrop.WSO[i];
+
+	T LAIEM = lcrop.WLV[i] * lcrop.SLA[o];
+	lcrop.LV[o] = lcrop.WLV[i];
+	lcrop.LASUM[i] = LAIEM;
+	lcrop.LAIEXP[i] = LAIEM;
+	lcrop.SAI[i] = lcrop.WST[i] * AFGEN(crop.p.SSATB, DVS);
+	lcrop.PAI[i] = lcrop.WSO[i] * crop.p.SPA;
+	lcrop.LAI[i] = lcrop.LASUM[i] + lcrop.SAI[i] + lcrop.PAI[i];
+
+	lcrop.TMINRA[i] = 0.;
+	for (size_t j=0; j<7; j++) {
+		lcrop.TMNSAV[i*7+j] = -99;
+	}
+}
+
+
+template <class T>
+std::vector<double> WofostBatchModelT<T>::run(const std::vector<long> &mstart) {
+
+	size_t nc = wth.ncells;
+	size_t nsim = mstart.size();
+	std::vector<double> out(nc * nsim, NAN);
+	fatalError = false;
+	FLOWDEV = 0;
+
+	size_t nd = wth.date.size();
+	if (nd < 1) {
+		messages.push_back("no weather data");
+		fatalError = true;
+		return out;
+	}
+	if ((soilindex.size() != nc) || (!overlay.empty() && (overlay.size() != nc))) {
+		messages.push_back("bad soil index or overlay data");
+		fatalError = true;
+		return out;
+	}
+	if (!prepare()) return out;
+
+	// a job for each start date and cell with weather data and a valid soil
+	jobs.resize(0);
+	for (size_t j=0; j<nsim; j++) {
+		if (mstart[j] < wth.date[0]) {
+			messages.push_back("model cannot start before beginning of the weather data");
+			continue;
+		} else if (mstart[j] > wth.date[nd-1]) {
+			messages.push_back("model cannot start after the end of the weather data");
+			continue;
+		}
+		unsigned start = date_index(wth.date, mstart[j]);
+		for (size_t c=0; c<nc; c++) {
+			if (std::isnan(wth.tmin[c])) continue;
+			if ((soilindex[c] < 0) || (soilindex[c] >= (int)psoils.size())) continue;
+			jobs.push_back({c, j, start});
+		}
+	}
+	if (jobs.empty()) return out;
+
+	size_t n = jobs.size();
+	if ((maxlanes > 0) && (maxlanes < n)) n = maxlanes;
+	job.resize(n);
+	cell.resize(n);
+	time.resize(n);
+	step.resize(n);
+	cropstart_step.resize(n);
+	maxdur.resize(n);
+	emergence.resize(n);
+	ISTATE.resize(n);
+	phase.resize(n);
+	fatal.resize(n);
+	yield.resize(n);
+	latm.resize(n);
+	lcrop.resize(n, std::max(control.IDURMX, 0) + 2);
+	lsoil.resize(n);
+
+	for (size_t i=0; i<n; i++) {
+		lane_initialize(i, i);
+	}
+	nlanes = n;
+	nextjob = n;
+
+	while (nlanes > 0) {
+		day();
+		refill(out);
+	}
+	bool gw = false;
+	for (size_t j=0; j<psoils.size(); j++) gw = gw || psoils[j]->p.IZT;
+	if (control.water_limited && gw && (control.subsol_table == 2)) {
+		messages.push_back("maximum deviation of the tabulated SUBSOL flow: " + std::to_string(FLOWDEV) + " cm/d");
+	}
+	return out;
+}
+
+
+// collect the results of the lanes that are done, start the next
+// jobs in these lanes, and, when there are no more jobs, move the
+// remaining active lanes to the front
+template <class T>
+void WofostBatchModelT<T>::refill(std::vector<double> &out) {
+	size_t nc = wth.ncells;
+	size_t nempty = 0;
+	for (size_t i=0; i<nlanes; i++) {
+		if (phase[i] == LANE_EMPTY) {
+			nempty++;
+		} else if (phase[i] == LANE_DONE) {
+			const WofostBatchJob &b = jobs[job[i]];
+			out[b.sim * nc + b.cell] = yield[i];
+			if (nextjob < jobs.size()) {
+				lane_initialize(i, nextjob);
+				nextjob++;
+			} else {
+				phase[i] = LANE_EMPTY;
+				nempty++;
+			}
+		}
+	}
+	if ((nempty > 0) && ((nempty == nlanes) || (4 * nempty >= nlanes))) {
+		compact();
+	}
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::compact() {
+	size_t k = 0;
+	for (size_t i=0; i<nlanes; i++) {
+		if (phase[i] == LANE_EMPTY) continue;
+		if (k != i) lane_copy(k, i);
+		k++;
+	}
+	nlanes = k;
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::lane_copy(size_t to, size_t from) {
+	job[to] = job[from];
+	cell[to] = cell[from];
+	time[to] = time[from];
+	step[to] = step[from];
+	cropstart_step[to] = cropstart_step[from];
+	maxdur[to] = maxdur[from];
+	emergence[to] = emergence[from];
+	ISTATE[to] = ISTATE[from];
+	phase[to] = phase[from];
+	fatal[to] = fatal[from];
+	yield[to] = yield[from];
+	latm.copy(to, from);
+	lcrop.copy(to, from);
+	lsoil.copy(to, from);
+}
+
+
+// one day for all lanes
+template <class T>
+void WofostBatchModelT<T>::day() {
+
+// soil water balance before emergence
+	weather_step(LANE_SOIL);
+	soil_rates(LANE_SOIL);
+	for (size_t i=0; i<nlanes; i++) {
+		if (phase[i] != LANE_SOIL) continue;
+		bool emerged = false;
+		if (step[i] >= cropstart_step[i]) {
+			if (ISTATE[i] == 1) {
+				lcrop.DVS[i] += lcrop.DVR[i];
+				lcrop.TSUME[i] += lcrop.DTSUME[i];
+				if (lcrop.DVS[i] >= 0) {
+					ISTATE[i] = 3;
+					emerged = true;
+					lcrop.DVS[i] = 0;
+				} else {
+					lcrop.DTSUME[i] = LIMIT(0., crop.p.TEFFMX - crop.p.TBASEM, latm.TEMP[i] - crop.p.TBASEM);
+					lcrop.DVR[i] = 0.1 * lcrop.DTSUME[i] / crop.p.TSUMEM;
+				}
+			} else {
+				emerged = true;
+			}
+		}
+		if (emerged || fatal[i]) {
+			emergence[i] = step[i];
+			crop_initialize(i);
+			maxdur[i] = step[i] + control.IDURMX;
+			phase[i] = LANE_CROP;
+		} else {
+			yield[i] = lcrop.WSO[i];
+		}
+	}
+	soil_states(LANE_SOIL);
+	advance(LANE_SOIL);
+
+// crop growth
+	for (size_t i=0; i<nlanes; i++) {
+		if (phase[i] != LANE_CROP) continue;
+		if ((!lcrop.alive[i]) || (step[i] >= maxdur[i])) {
+			if (control.stop_maturity) {
+				phase[i] = LANE_DONE;
+			} else {
+				lcrop.TRA[i] = 0;
+				phase[i] = LANE_FALLOW;
+			}
+		}
+	}
+	weather_step(LANE_CROP);
+	crop_rates(LANE_CROP);
+	soil_rates(LANE_CROP);
+	for (size_t i=0; i<nlanes; i++) {
+		if (phase[i] != LANE_CROP) continue;
+		yield[i] = lcrop.WSO[i];
+	}
+	crop_states(LANE_CROP);
+	soil_states(LANE_CROP);
+	advance(LANE_CROP);
+	for (size_t i=0; i<nlanes; i++) {
+		if ((phase[i] == LANE_CROP) && fatal[i]) {
+			phase[i] = LANE_DONE;
+		}
+	}
+
+// water balance after maturity (if !stop_maturity)
+	for (size_t i=0; i<nlanes; i++) {
+		if ((phase[i] == LANE_FALLOW) && (step[i] >= maxdur[i])) {
+			phase[i] = LANE_DONE;
+		}
+	}
+	weather_step(LANE_FALLOW);
+	soil_rates(LANE_FALLOW);
+	for (size_t i=0; i<nlanes; i++) {
+		if (phase[i] != LANE_FALLOW) continue;
+		lsoil.EVWMX[i] = latm.E0[i];
+		lsoil.EVSMX[i] = latm.ES0[i];
+		yield[i] = lcrop.WSO[i];
+	}
+	soil_states(LANE_FALLOW);
+	advance(LANE_FALLOW);
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::advance(char p) {
+	for (size_t i=0; i<nlanes; i++) {
+		if (phase[i] != p) continue;
+		time[i]++;
+		step[i]++;
+	}
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::weather_step(char p) {
+	size_t nc = wth.ncells;
+	size_t nd = wth.date.size();
+	for (size_t i=0; i<nlanes; i++) {
+		if (phase[i] != p) continue;
+		// end of the weather data, or a missing value. As in WofostModel::run,
+		// the crop stops growing, but the water balance before emergence and
+		// after maturity continues with the previous weather
+		size_t k = time[i] * nc + cell[i];
+		if ((time[i] >= nd) || std::isnan(wth.tmin[k]) || std::isnan(wth.tmax[k]) ||
+				std::isnan(wth.prec[k]) || std::isnan(wth.srad[k]) ||
+				std::isnan(wth.vapr[k]) || std::isnan(wth.wind[k])) {
+			fatal[i] = true;
+			if (p == LANE_CROP) {
+				if (control.stop_maturity) {
+					phase[i] = LANE_DONE;
+				} else {
+					lcrop.TRA[i] = 0;
+					phase[i] = LANE_FALLOW;
+				}
+			}
+			continue;
+		}
+		latm.TMIN[i] = wth.tmin[k];
+		latm.TMAX[i] = wth.tmax[k];
+		latm.TEMP[i] = (latm.TMIN[i] + latm.TMAX[i]) / 2.;
+		latm.DTEMP[i] = (latm.TMAX[i] + latm.TEMP[i]) / 2.;
+		latm.AVRAD[i] = wth.srad[k] * 1000;
+		latm.WIND[i] = wth.wind[k];
+		latm.VAP[i] = wth.vapr[k] * 10;
+		latm.RAIN[i] = wth.prec[k] / 10;
+		latm.DOY[i] = doy_from_days(wth.date[time[i]]);
+
+		ASTRO(i);
+		PENMAN(i);
+		PENMAN_MONTEITH(i);
+		EVTRA(i);
+	}
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::ASTRO(size_t i) {
+	T PI = 3.141592653589793238462643383279502884197169399375;
+	T ANGLE = -4, RAD = 0.0174533;
+	T DOY = latm.DOY[i];
+	T DEC = -asin( sin(23.45 * RAD) * cos(2. * PI * (DOY + 10.)/365.));
+	T SC = 1370. * (1. + 0.033 * cos(2. * PI * DOY/365.));
+
+	T SINLD = sin(RAD * latm.latitude[i]) * sin(DEC);
+	T COSLD = cos(RAD * latm.latitude[i]) * cos(DEC);
+	T AOB = SINLD / COSLD;
+	T DAYL, DSINB, DSINBE;
+	if (AOB > 1.0) {
+		DAYL = 24.0;
+		DSINB  = 3600. * (DAYL * SINLD);
+		DSINBE = 3600. * (DAYL * (SINLD + 0.4 * (pow(SINLD, 2) + pow(COSLD, 2)*0.5)));
+	} else if (AOB < -1.0) {
+		DAYL = 0.;
+		DSINB  = 3600. * (DAYL * SINLD);
+		DSINBE = 3600. * (DAYL * (SINLD + 0.4 * (pow(SINLD, 2) + pow(COSLD, 2)*0.5)));
+	} else {
+		DAYL  = 12.0 * (1. + 2. * asin(AOB) / PI);
+		DSINB = 3600. * (DAYL * SINLD + 24. * COSLD * sqrt(1. - pow(AOB, 2)) / PI);
+		DSINBE = 3600. * (DAYL * (SINLD + 0.4 * (pow(SINLD, 2) + pow(COSLD, 2) * 0.5)) + 12. * COSLD * (2. + 3. * 0.4 * SINLD) * sqrt(1. - pow(AOB, 2)) / PI);
+	}
+
+	T AOB_CORR = (-sin(ANGLE * RAD) + SINLD) / COSLD;
+	if (AOB_CORR > 1.0) {
+		latm.DAYLP[i] = 24.0;
+	} else if (AOB_CORR < -1.0) {
+		latm.DAYLP[i] = 0.0;
+	} else {
+		latm.DAYLP[i] = 12.0 * (1. + 2. * asin(AOB_CORR)/PI);
+	}
+
+	T ANGOT = SC * DSINB;
+	T ATMTR = DAYL > 0.0 ? latm.AVRAD[i] / ANGOT : 0;
+
+	T FRDif;
+	if (ATMTR > 0.75) {
+		FRDif = 0.23;
+	} else if (ATMTR <= 0.75 && ATMTR > 0.35) {
+		FRDif = 1.33 - 1.46 * ATMTR;
+	} else if (ATMTR <= 0.35 && ATMTR > 0.07) {
+		FRDif = 1. - 2.3 * pow((ATMTR - 0.07), 2);
+	} else {
+		FRDif = 1.;
+	}
+
+	latm.SINLD[i] = SINLD;
+	latm.COSLD[i] = COSLD;
+	latm.DAYL[i] = DAYL;
+	latm.DSINB[i] = DSINB;
+	latm.DSINBE[i] = DSINBE;
+	latm.ANGOT[i] = ANGOT;
+	latm.ATMTR[i] = ATMTR;
+	latm.DifPP[i] = FRDif * ATMTR * 0.5 * SC;
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::PENMAN(size_t i) {
+	T PSYCON = 0.67;
+	T REFCFW = 0.05, REFCFS = 0.15, REFCFC = 0.25;
+	T LHVAP = 2.45e6;
+	T STBC = 4.9e-3;
+
+	T TMPA  = ( latm.TMIN[i] + latm.TMAX[i] ) / 2.;
+	T TDif  = latm.TMAX[i] - latm.TMIN[i];
+	T BU    = 0.54 + 0.35 * clamp(0, 1, (TDif - 12.) / 4.);
+	T PBAR  = 1013. * exp(-0.034 * latm.elevation[i] / (TMPA+273.));
+	T GAMMA = PSYCON * PBAR/1013.;
+	T SVAP  = 6.10588 * exp (17.32491*TMPA / (TMPA+238.102));
+	T DELTA = 238.102 * 17.32491 * SVAP / pow((TMPA+238.102), 2);
+	T VAP   = std::min<T>(latm.VAP[i], SVAP);
+	T RELSSD = LIMIT(0.,1., (latm.ATMTR[i] - std::abs(control.ANGSTA)) / std::abs(control.ANGSTB));
+	T RB  = STBC * pow((TMPA+273.), 4) * (0.56-0.079 * sqrt(VAP)) * (0.1+0.9*RELSSD);
+	T AVRAD = latm.AVRAD[i];
+	T RNW = (AVRAD * (1.-REFCFW)-RB) / LHVAP;
+	T RNS = (AVRAD * (1.-REFCFS)-RB) / LHVAP;
+	T RNC = (AVRAD * (1.-REFCFC)-RB) / LHVAP;
+	T EA  = 0.26 * std::max<T>(0.,(SVAP-VAP)) * (0.5+BU * latm.WIND[i]);
+	T EAC = 0.26 * std::max<T>(0.,(SVAP-VAP)) * (1.0+BU * latm.WIND[i]);
+	T E0  = (DELTA*RNW+GAMMA*EA)/(DELTA+GAMMA);
+	T ES0 = (DELTA*RNS+GAMMA*EA)/(DELTA+GAMMA);
+	T ET0 = (DELTA*RNC+GAMMA*EAC)/(DELTA+GAMMA);
+	latm.E0[i]  = std::max<T>(0., E0) / 10;
+	latm.ES0[i] = std::max<T>(0., ES0) / 10;
+	latm.ET0[i] = std::max<T>(0., ET0) / 10;
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::PENMAN_MONTEITH(size_t i) {
+	T PSYCON = 0.665;
+	T REFCFC = 0.23;
+	T CRES = 70.;
+	T LHVAP = 2.45E6;
+	T STBC = 4.903E-3;
+	T G = 0.;
+
+	T TMIN = latm.TMIN[i];
+	T TMAX = latm.TMAX[i];
+	T TMPA = (TMIN + TMAX) / 2.;
+	T VAP = latm.VAP[i] / 10;
+	T TK = 293.0;
+	T PATM = 101.3 * pow((TK - (0.0065 * latm.elevation[i]))/TK, 5.26);
+	T GAMMA = PSYCON * PATM * 1.0E-3;
+	T SVAP_TMPA = SatVapourPressure(TMPA);
+	T DELTA = (4098. * SVAP_TMPA)/pow((TMPA + 237.3), 2);
+	T SVAP_TMAX = SatVapourPressure(TMAX);
+	T SVAP_TMIN = SatVapourPressure(TMIN);
+	T SVAP = (SVAP_TMAX + SVAP_TMIN) / 2.;
+	VAP = std::min<T>(VAP, SVAP);
+	T STB_TMAX = STBC * pow(Celsius2Kelvin(TMAX), 4);
+	T STB_TMIN = STBC * pow(Celsius2Kelvin(TMIN), 4);
+	T RNL_TMP = ((STB_TMAX + STB_TMIN) / 2.) * (0.34 - 0.14 * sqrt(VAP));
+	T CSKYRAD = (0.75 + (2e-05 * latm.elevation[i])) * latm.ANGOT[i];
+
+	if (CSKYRAD > 0) {
+		T WIND = latm.WIND[i];
+		T AVRAD = latm.AVRAD[i];
+		T RNL = RNL_TMP * (1.35 * (AVRAD/CSKYRAD) - 0.35);
+		T RN = ((1-REFCFC) * AVRAD - RNL)/LHVAP;
+		T EA = ((900./(TMPA + 273)) * WIND * (SVAP - VAP));
+		T MGAMMA = GAMMA * (1. + (CRES/208. * WIND));
+		T ET0 = (DELTA * (RN-G))/(DELTA + MGAMMA) + (GAMMA * EA)/(DELTA + MGAMMA);
+		latm.ET0[i] = std::max<T>(0., ET0 / 10);
+	} else {
+		latm.ET0[i] = 0.;
+	}
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::EVTRA(size_t i) {
+	const WofostSoilParameters &sp = psoils[lsoil.sidx[i]]->p;
+	T KGLOB = 0.75 * lcrop.KDif[i];
+	latm.ET0[i] = crop.p.CFET * latm.ET0[i];
+	T ET0 = latm.ET0[i];
+
+	T EKL = exp( -KGLOB * lcrop.LAI[i]);
+	lsoil.EVWMX[i] = latm.E0[i] * EKL;
+	lsoil.EVSMX[i] = std::max<T>(0., latm.ES0[i] * EKL);
+	T TRAMX = std::max<T>(0.0001, ET0*(1. - EKL));
+	lcrop.TRAMX[i] = TRAMX;
+
+	if (! control.water_limited) {
+		lcrop.TRA[i] = TRAMX;
+	} else {
+		T SM = lsoil.SM[i];
+		T SWDEP = SWEAF(ET0, crop.p.DEPNR);
+		T SMCR = (1. - SWDEP) * (sp.SMFCF - sp.SMW) + sp.SMW;
+		T RFWS = LIMIT(0.,1., (SM - sp.SMW) / (SMCR - sp.SMW));
+		T RFOS = 1.;
+		if ((!crop.p.IAIRDU) && (control.IOXWL)) {
+			T SMAIR = sp.SM0 - sp.CRAIRC;
+			T DSOS = 0;
+			if (SM >= SMAIR) {
+				DSOS = std::min<T>((DSOS + 1.), 4.);
+			}
+			T RFOSMX = clamp(0, 1, (sp.SM0 - SM)/(sp.SM0 - SMAIR));
+			RFOS = RFOSMX + (1 - DSOS/4) * (1-RFOSMX);
+		}
+		lcrop.RFTRA[i] = RFWS * RFOS;
+		lcrop.TRA[i] = lcrop.RFTRA[i] * TRAMX;
+		lcrop.TRANRF[i] = lcrop.TRA[i] / TRAMX;
+	}
+}
+
+
+template <class T>
+T WofostBatchModelT<T>::TOTASS(size_t i) {
+	T XGAUSS[3] = {0.1127017, 0.5000000, 0.8872983};
+	T WGAUSS[3] = {0.2777778, 0.4444444, 0.2777778};
+	T PI = 3.141592653589793238462643383279502884197169399375;
+
+	T DTGA = 0;
+	if (lcrop.AMAX[i] > 0. && lcrop.LAI[i] > 0) {
+		T DAYL = latm.DAYL[i];
+		for (int j = 0; j < 3; j++) {
+			T HOUR = 12.0 + 0.5 * DAYL * XGAUSS[j];
+			T SINB = std::max<T>(0., latm.SINLD[i] + latm.COSLD[i] * cos(2 * PI * (HOUR + 12) / 24));
+			T PAR = 0.5 * latm.AVRAD[i] * SINB * (1.+0.4 * SINB) / latm.DSINBE[i];
+			T PARDIF = std::min<T>(PAR, SINB * latm.DifPP[i]);
+			T PARDIR = PAR-PARDIF;
+			T FGROS = ASSIM(lcrop.AMAX[i], lcrop.EFF[i], lcrop.LAI[i], lcrop.KDif[i], SINB, PARDIR, PARDIF);
+			DTGA = DTGA + FGROS * WGAUSS[j];
+		}
+		DTGA = DTGA * DAYL;
+	}
+	return DTGA;
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::crop_rates(char p) {
+
+	const WofostCropParameters &cp = crop.p;
+	size_t nc = lcrop.nclass;
+
+	for (size_t i=0; i<nlanes; i++) {
+		if (phase[i] != p) continue;
+
+		T *TMNSAV = &lcrop.TMNSAV[i*7];
+		std::move(TMNSAV+1, TMNSAV+7, TMNSAV);
+		TMNSAV[6] = latm.TMIN[i];
+		T TMINRA = 0.;
+		int n = 0;
+		for (int j = 0; j < 7; j++) {
+			if (TMNSAV[j] != -99) {
+				TMINRA += TMNSAV[j];
+				n++;
+			}
+		}
+		TMINRA = TMINRA / T(n);
+		lcrop.TMINRA[i] = TMINRA;
+
+		T DVS = lcrop.DVS[i];
+		T TEMP = latm.TEMP[i];
+		lcrop.DTSUM[i] = AFGEN(cp.DTSMTB, TEMP);
+		if (DVS < 1.) {
+			T DVR = lcrop.DTSUM[i] / cp.TSUM1;
+			T DVRED;
+			if (cp.IDSL >= 1) {
+				DVRED = LIMIT(0., 1., (latm.DAYLP[i] - cp.DLC)/(cp.DLO - cp.DLC));
+			} else {
+				DVRED = 1;
+			}
+			lcrop.DVR[i] = DVR * DVRED;
+		} else {
+			lcrop.DVR[i] = lcrop.DTSUM[i] / cp.TSUM2;
+		}
+
+		lcrop.AMAX[i] = AFGEN(crop.AMAXTB, DVS) * AFGEN(cp.TMPFTB, latm.DTEMP[i]);
+		lcrop.KDif[i] = AFGEN(cp.KDIFTB, DVS);
+		lcrop.EFF[i] = AFGEN(cp.EFFTB, latm.DTEMP[i]);
+
+		T DTGA = TOTASS(i);
+		DTGA = DTGA * AFGEN(cp.TMNFTB, TMINRA);
+		lcrop.PGASS[i] = DTGA * 30./44.;
+
+		T TRA = lcrop.TRA[i];
+		T TRAMX = lcrop.TRAMX[i];
+		T reduction = TRA / TRAMX;
+		T GASS = lcrop.PGASS[i] * reduction;
+		lcrop.GASS[i] = GASS;
+
+		T WRT = lcrop.WRT[i];
+		T WLV = lcrop.WLV[i];
+		T WST = lcrop.WST[i];
+		T RMRES = (cp.RMR * WRT + cp.RML * WLV + cp.RMS * WST + cp.RMO * lcrop.WSO[i]);
+		RMRES *= AFGEN (cp.RFSETB, DVS);
+		T TEFF  = pow(cp.Q10, ((TEMP - 25.)/10.));
+		lcrop.PMRES[i] = RMRES * TEFF;
+		T MRES  = std::min<T>(GASS, lcrop.PMRES[i]);
+		T ASRC  = GASS - MRES;
+
+		T Fr = AFGEN(cp.FRTB, DVS);
+		T Fl = AFGEN(cp.FLTB, DVS);
+		T Fs = AFGEN(cp.FSTB, DVS);
+		T Fo = AFGEN(cp.FOTB, DVS);
+		lcrop.Fr[i] = Fr;
+		lcrop.Fl[i] = Fl;
+		lcrop.Fs[i] = Fs;
+		lcrop.Fo[i] = Fo;
+		lcrop.TRANRF[i] = TRA / TRAMX;
+
+		T CVF = 1./((Fl/cp.CVL + Fs/cp.CVS + Fo/cp.CVO)*(1. - Fr) + Fr/cp.CVR);
+		T DMI = CVF * ASRC;
+
+		T ADMI = (1. - Fr) * DMI;
+		T GRRT = Fr * DMI;
+		lcrop.DRRT[i] = WRT * AFGEN(cp.RDRRTB, DVS);
+		lcrop.GWRT[i] = GRRT - lcrop.DRRT[i];
+
+		lcrop.GRLV[i] = Fl * ADMI;
+		T DSLV1 = WLV * (1. - TRA/TRAMX) * cp.PERDL;
+		T LAICR = 3.2 / lcrop.KDif[i];
+		T DSLV2 = WLV * LIMIT(0., 0.03, 0.03 * (lcrop.LAI[i] - LAICR)/LAICR);
+		T DSLV = std::max<T>(DSLV1, DSLV2);
+		lcrop.DSLV[i] = DSLV;
+
+		// leaf death, starting with the oldest leaf class
+		const T *LV = &lcrop.LV[i*nc];
+		const T *LVAGE = &lcrop.LVAGE[i*nc];
+		size_t last = lcrop.LVNEW[i];
+		size_t j = lcrop.LVOLD[i];
+		T REST = DSLV;
+		while (j <= last && REST > LV[j]) {
+			REST = REST - LV[j];
+			j++;
+		}
+		T DALV = 0.;
+		if (j <= last && LVAGE[j] > cp.SPAN && REST > 0.) {
+			DALV = LV[j] - REST;
+			REST = 0.;
+			j++;
+		}
+		while (j <= last && LVAGE[j] > cp.SPAN) {
+			DALV += LV[j];
+			j++;
+		}
+		lcrop.DRLV[i] = DSLV + DALV;
+
+		lcrop.FYSDEL[i] = std::max<T>(0., (TEMP - cp.TBASE)/(35. - cp.TBASE));
+		T SLAT = AFGEN(cp.SLATB, DVS);
+
+		if (lcrop.LAIEXP[i] < 6) {
+			T DTEFF = std::max<T>(0., TEMP - cp.TBASE);
+			lcrop.GLAIEX[i] = lcrop.LAIEXP[i] * cp.RGRLAI * DTEFF;
+			T GLASOL = lcrop.GRLV[i] * SLAT;
+			T GLA = std::min<T>(lcrop.GLAIEX[i], GLASOL);
+			if (lcrop.GRLV[i] > 0.) {
+				SLAT = GLA / lcrop.GRLV[i];
+			}
+		}
+		lcrop.SLAT[i] = SLAT;
+
+		T GRST = Fs * ADMI;
+		lcrop.DRST[i] = AFGEN(cp.RDRSTB, DVS) * WST;
+		lcrop.GWST[i] = GRST - lcrop.DRST[i];
+
+		lcrop.GWSO[i] = Fo * ADMI;
+		lcrop.DRSO[i] = 0.;
+
+		// ROOTD_rates
+		lcrop.RR[i] = 0;
+		if (Fr > 0) {
+			if (cp.IAIRDU || ((lsoil.ZT[i] - lcrop.RD[i]) >= 10)) {
+				lcrop.RR[i] = std::min<T>(lsoil.RDM[i] - lcrop.RD[i], cp.RRI);
+			}
+		}
+	}
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::crop_states(char p) {
+
+	const WofostCropParameters &cp = crop.p;
+	size_t nc = lcrop.nclass;
+
+	for (size_t i=0; i<nlanes; i++) {
+		if (phase[i] != p) continue;
+
+		lcrop.DVS[i] += lcrop.DVR[i];
+		lcrop.TSUM[i] += lcrop.DTSUM[i];
+		if (lcrop.DVS[i] >= 1. && lcrop.IDANTH[i] < 0) {
+			lcrop.IDANTH[i] = int(step[i]) - emergence[i];
+			lcrop.DVS[i] = 1.;
+		}
+
+		// leaf death, starting with the oldest leaf class; running
+		// sums of leaf area and weight as in WofostModel
+		T *LV = &lcrop.LV[i*nc];
+		T *SLA = &lcrop.SLA[i*nc];
+		T *LVAGE = &lcrop.LVAGE[i*nc];
+		size_t last = lcrop.LVNEW[i];
+		size_t j = lcrop.LVOLD[i];
+		T LASUM = lcrop.LASUM[i];
+		T WLV = lcrop.WLV[i];
+		T DSLVT = lcrop.DSLV[i];
+		while (DSLVT > 0. && j <= last) {
+			if (DSLVT >= LV[j]) {
+				DSLVT = DSLVT - LV[j];
+				LASUM -= LV[j] * SLA[j];
+				WLV -= LV[j];
+				LV[j] = 0.;
+				j++;
+			} else {
+				LV[j] = LV[j] - DSLVT;
+				LASUM -= DSLVT * SLA[j];
+				WLV -= DSLVT;
+				DSLVT = 0.;
+			}
+		}
+		while (j <= last && LVAGE[j] >= cp.SPAN) {
+			LASUM -= LV[j] * SLA[j];
+			WLV -= LV[j];
+			LV[j] = 0.;
+			j++;
+		}
+		if (j > last) {
+			LASUM = 0.;
+			WLV = 0.;
+		}
+		lcrop.LVOLD[i] = j;
+
+		// physiological ageing of the remaining leaves; new leaves
+		for (size_t k = j; k <= last; k++) {
+			LVAGE[k] += lcrop.FYSDEL[i];
+		}
+		last++;
+		lcrop.LVNEW[i] = last;
+		LV[last] = lcrop.GRLV[i];
+		SLA[last] = lcrop.SLAT[i];
+		LVAGE[last] = 0.;
+		LASUM += lcrop.GRLV[i] * lcrop.SLAT[i];
+		WLV += lcrop.GRLV[i];
+		lcrop.LASUM[i] = LASUM;
+		lcrop.WLV[i] = WLV;
+
+		lcrop.LAIEXP[i] += lcrop.GLAIEX[i];
+		lcrop.WRT[i] += lcrop.GWRT[i];
+		lcrop.WST[i] += lcrop.GWST[i];
+		lcrop.WSO[i] += lcrop.GWSO[i];
+		lcrop.TADW[i] = WLV + lcrop.WST[i] + lcrop.WSO[i];
+
+		lcrop.DWRT[i] += lcrop.DRRT[i];
+		lcrop.DWLV[i] += lcrop.DRLV[i];
+		lcrop.DWST[i] += lcrop.DRST[i];
+		lcrop.DWSO[i] += lcrop.DRSO[i];
+
+		lcrop.TWRT[i] = lcrop.WRT[i] + lcrop.DWRT[i];
+		lcrop.TWLV[i] = WLV + lcrop.DWLV[i];
+		lcrop.TWST[i] = lcrop.WST[i] + lcrop.DWST[i];
+		lcrop.TWSO[i] = lcrop.WSO[i] + lcrop.DWSO[i];
+		lcrop.TAGP[i] = lcrop.TWLV[i] + lcrop.TWST[i] + lcrop.TWSO[i];
+
+		lcrop.SAI[i] = lcrop.WST[i] * AFGEN(cp.SSATB, lcrop.DVS[i]);
+		lcrop.PAI[i] = lcrop.WSO[i] * cp.SPA;
+		lcrop.LAI[i] = LASUM + lcrop.SAI[i] + lcrop.PAI[i];
+
+		// ROOTD_states
+		lcrop.RD[i] += lcrop.RR[i];
+
+		if (lcrop.DVS[i] >= cp.DVSEND) {
+			lcrop.alive[i] = false;
+		} else if (lcrop.LAI[i] <= 0.002 && lcrop.DVS[i] > 0.5) {
+			lcrop.alive[i] = false;
+		}
+	}
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::soil_rates(char p) {
+	for (size_t i=0; i<nlanes; i++) {
+		if (phase[i] != p) continue;
+		if (!control.water_limited) {
+			WATPP_rates(i);
+		} else if (psoils[lsoil.sidx[i]]->p.IZT) {
+			WATGW_rates(i);
+		} else {
+			WATFD_rates(i);
+		}
+	}
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::soil_states(char p) {
+	for (size_t i=0; i<nlanes; i++) {
+		if (phase[i] != p) continue;
+		if (!control.water_limited) {
+			lsoil.SM[i] = psoils[lsoil.sidx[i]]->p.SMFCF;
+		} else if (psoils[lsoil.sidx[i]]->p.IZT) {
+			WATGW_states(i);
+		} else {
+			WATFD_states(i);
+		}
+	}
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::WATPP_rates(size_t i) {
+	const WofostSoilParameters &sp = psoils[lsoil.sidx[i]]->p;
+	if (!crop.p.IAIRDU) {
+		lsoil.EVS[i] = lsoil.EVSMX[i] * (sp.SMFCF - sp.SMW / 3.) / (sp.SM0 - sp.SMW / 3.);
+		lsoil.EVW[i] = 0;
+	} else {
+		lsoil.EVS[i] = 0;
+		lsoil.EVW[i] = lsoil.EVWMX[i];
+	}
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::WATFD_rates(size_t i) {
+	const WofostSoilParameters &sp = psoils[lsoil.sidx[i]]->p;
+	T RD = lcrop.RD[i];
+	T TRA = lcrop.TRA[i];
+	T ss = lsoil.ss[i];
+	T RAIN = latm.RAIN[i];
+
+	T EVW = 0.;
+	T EVS = 0.;
+	if (ss > 1.) {
+		EVW = lsoil.EVWMX[i];
+	} else {
+		T EVSMX = lsoil.EVSMX[i];
+		if (lsoil.RINold[i] >= 1.) {
+			EVS = EVSMX;
+			lsoil.DSLR[i] = 1.;
+		} else {
+			T DSLR = lsoil.DSLR[i] + 1.;
+			lsoil.DSLR[i] = DSLR;
+			T EVSMXT = EVSMX * (sqrt(DSLR) - sqrt(DSLR - 1.));
+			EVS = std::min<T>(EVSMX, EVSMXT + lsoil.RINold[i]);
+		}
+	}
+
+	T RINPRE;
+	if (sp.IFUNRN == 0) {
+		RINPRE = (1 - sp.NOTINF) * RAIN;
+	} else {
+		RINPRE = (1 - sp.NOTINF * AFGEN(sp.NINFTB, RAIN)) * RAIN;
+	}
+	RINPRE += lsoil.RIRR[i] + ss;
+	if (ss > 0.1) {
+		T AVAIL = RINPRE + lsoil.RIRR[i] - EVW;
+		RINPRE = std::min<T>(sp.SOPE, AVAIL);
+	}
+
+	T W = lsoil.W[i];
+	T RDM = lsoil.RDM[i];
+	T WE = sp.SMFCF * RD;
+	T PERC1 = LIMIT (0., sp.SOPE, (W - WE) - TRA - EVS);
+
+	if (!crop.p.IAIRDU) {
+		T WELOW = sp.SMFCF * (RDM - RD);
+		lsoil.LOSS[i] = LIMIT (0., sp.KSUB, (lsoil.WLOW[i] - WELOW) + PERC1 );
+	} else {
+		lsoil.LOSS[i] = std::min<T>(lsoil.LOSS[i], 0.05 * sp.K0);
+	}
+	T PERC2 = ((RDM - RD) * sp.SM0 - lsoil.WLOW[i]) + lsoil.LOSS[i];
+	T PERC = std::min<T>(PERC1, PERC2);
+
+	T RIN = std::min<T>(RINPRE, (sp.SM0 - lsoil.SM[i]) * RD + TRA + EVS + PERC);
+	lsoil.RIN[i] = RIN;
+	lsoil.RINold[i] = RIN;
+	T DW = RIN - TRA - EVS - PERC;
+	lsoil.DWLOW[i] = PERC - lsoil.LOSS[i];
+
+	T Wtmp = W + DW;
+	if (Wtmp < 0.0) {
+		EVS += Wtmp;
+		DW = -W;
+	}
+	lsoil.EVW[i] = EVW;
+	lsoil.EVS[i] = EVS;
+	lsoil.PERC[i] = PERC;
+	lsoil.DW[i] = DW;
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::WATFD_states(size_t i) {
+	const WofostSoilParameters &sp = psoils[lsoil.sidx[i]]->p;
+	T SSPRE = lsoil.ss[i] + (latm.RAIN[i] + lsoil.RIRR[i] - lsoil.EVW[i] - lsoil.RIN[i]);
+	lsoil.ss[i] = std::min<T>(SSPRE, sp.SSMAX);
+	T W = std::max<T>(0.0, lsoil.W[i] + lsoil.DW[i]);
+	lsoil.WLOW[i] += lsoil.DWLOW[i];
+	lsoil.WWLOW[i] = W + lsoil.WLOW[i];
+	if (lcrop.RR[i] > 0.001) {
+		T WDR = lsoil.WLOW[i] * (lcrop.RR[i])/(lsoil.RDM[i] - lcrop.RDOLD[i]);
+		W += WDR;
+	}
+	lsoil.W[i] = W;
+	lsoil.SM[i] = W / lcrop.RD[i];
+	lcrop.RDOLD[i] = lcrop.RD[i];
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::WATGW_rates(size_t i) {
+	const WofostSoil &s = *psoils[lsoil.sidx[i]];
+	const WofostSoilParameters &sp = s.p;
+	T RD = lcrop.RD[i];
+	T TRA = lcrop.TRA[i];
+	T ss = lsoil.ss[i];
+	T RAIN = latm.RAIN[i];
+	T W = lsoil.W[i];
+	T ZT = lsoil.ZT[i];
+
+	T EVW = 0.;
+	T EVS = 0.;
+	if (ss > 1.) {
+		EVW = lsoil.EVWMX[i];
+	} else {
+		T EVSMX = lsoil.EVSMX[i];
+		if (lsoil.RIN[i] >= 1.) {
+			EVS = EVSMX;
+			lsoil.DSLR[i] = 1.;
+		} else {
+			T DSLR = lsoil.DSLR[i] + 1;
+			lsoil.DSLR[i] = DSLR;
+			T EVSMXT = EVSMX * (sqrt(DSLR) - sqrt(DSLR - 1.));
+			EVS = std::min<T>(EVSMX, EVSMXT + lsoil.RIN[i]);
+		}
+	}
+
+	T RINPRE;
+	if (ss > 0.1) {
+		T AVAIL = ss + (RAIN * (1. - sp.NOTINF) + lsoil.RIRR[i] - EVW);
+		RINPRE = std::min<T>(sp.SOPE, AVAIL);
+	} else {
+		if (sp.IFUNRN == 0) {
+			RINPRE = (1. - sp.NOTINF) * RAIN + lsoil.RIRR[i] + ss;
+		} else {
+			RINPRE = (1. - sp.NOTINF * AFGEN(sp.NINFTB, RAIN)) * RAIN + lsoil.RIRR[i] + ss;
+		}
+	}
+
+	T ZTMRD = ZT - RD;
+	T CR = 0.;
+	T PERC = 0.;
+	if (ZTMRD > 0.) {
+		lsoil.WE[i] = sp.SM0 * RD + lsoil.SUBAIR[i] - AFGENLOG2(s.SDEFTB, ZT);
+		lsoil.PF[i] = AFGEN(sp.PFTAB, lsoil.SM[i]);
+		T FLOW;
+		if (control.subsol_table > 0) {
+			FLOW = s.FLOWTB.get(lsoil.PF[i], ZTMRD, sp.CONTAB);
+			if (control.subsol_table == 2) {
+				FLOWDEV = std::max<double>(FLOWDEV, std::abs(FLOW - SUBSOL(lsoil.PF[i], ZTMRD, sp.CONTAB)));
+			}
+		} else {
+			FLOW = SUBSOL(lsoil.PF[i], ZTMRD, sp.CONTAB);
+		}
+		T WE = lsoil.WE[i];
+		if (FLOW >= 0.) {
+			CR = std::min<T>(FLOW, std::max<T>(WE - W, 0.));
+		}
+		if (FLOW <= 0.) {
+			PERC = -1. * std::max<T>(FLOW, std::min<T>(WE - W, 0.));
+		}
+		if (crop.p.IAIRDU) {
+			PERC = std::min<T>(PERC, 0.05 * sp.K0);
+		}
+	}
+
+	T DMAX;
+	if (sp.IDRAIN == 1 && ZT < sp.DD) {
+		T DR1 = 0.2 * sp.K0;
+		T DR2;
+		if (ZTMRD <= 0.) {
+			DR2 = std::max<T>(0., W + std::max<T>(0., sp.DD - RD) * sp.SM0 - lsoil.WEDTOT[i]);
+			DMAX = std::min<T>(DR1, DR2);
+		} else {
+			DR2 = (AFGENLOG2(s.SDEFTB, sp.DD - RD) - lsoil.SUBAIR[i]);
+			DMAX = std::min<T>(DR1, DR2);
+		}
+	} else {
+		DMAX = 0.;
+	}
+
+	T RIN, DZ;
+	if (ZTMRD <= 0.) {
+		T AIRC;
+		if (ZT >= 0.1) {
+			AIRC = (RD * sp.SM0 - W) / ZT;
+		} else {
+			AIRC = 0;
+		}
+		PERC = DMAX;
+		RIN = std::min<T>(RINPRE, AIRC * ZT + TRA + EVS + PERC);
+		DZ = (TRA + EVS + PERC - RIN) / AIRC;
+		if (DZ > RD - ZT) {
+			CR = (DZ - (RD - ZT)) * AIRC;
+			DZ = (AFGENBIN(s.DEFDTB, CR) + RD - ZT);
+		}
+	} else {
+		T DEF1 = lsoil.SUBAIR[i] + (DMAX + CR + PERC);
+		if (DEF1 < 0.) {
+			PERC = PERC + DEF1;
+		}
+		DZ = (AFGENBIN(s.DEFDTB, DEF1) + RD - ZT);
+		RIN = std::min<T>(RINPRE, (sp.SM0 - lsoil.SM[i] - 0.0004) * RD + TRA + EVS + PERC - CR);
+	}
+	lsoil.EVW[i] = EVW;
+	lsoil.EVS[i] = EVS;
+	lsoil.CR[i] = CR;
+	lsoil.PERC[i] = PERC;
+	lsoil.DMAX[i] = DMAX;
+	lsoil.RIN[i] = RIN;
+	lsoil.DZ[i] = DZ;
+	lsoil.DW[i] = TRA - EVS - PERC + CR + RIN;
+}
+
+
+template <class T>
+void WofostBatchModelT<T>::WATGW_states(size_t i) {
+	const WofostSoil &s = *psoils[lsoil.sidx[i]];
+	const WofostSoilParameters &sp = s.p;
+	T XDEF = 1000.;
+	T RD = lcrop.RD[i];
+	T RDOLD = lcrop.RDOLD[i];
+
+	T SSPRE = lsoil.ss[i] + (latm.RAIN[i] + lsoil.RIRR[i] - lsoil.EVW[i] - lsoil.RIN[i]);
+	lsoil.ss[i] = std::min<T>(SSPRE, sp.SSMAX);
+	T W = lsoil.W[i] + lsoil.DW[i];
+	T ZT = lsoil.ZT[i] + lsoil.DZ[i];
+	lsoil.ZT[i] = ZT;
+	T SUBAIR = AFGENLOG2(s.SDEFTB, ZT - RDOLD);
+	lsoil.WZ[i] = (XDEF - RDOLD) * sp.SM0 - SUBAIR;
+
+	if (RD - RDOLD > 0.001) {
+		T SUBAI0 = SUBAIR;
+		SUBAIR = AFGENLOG2(s.SDEFTB, ZT - RD);
+		lsoil.WZ[i] = (XDEF - RD) * sp.SM0 - SUBAIR;
+		T WDR = sp.SM0 * (RD - RDOLD) - (SUBAI0 - SUBAIR);
+		W += WDR;
+	}
+	lsoil.SUBAIR[i] = SUBAIR;
+	lsoil.W[i] = W;
+	lsoil.SM[i] = W / RD;
+	lcrop.RDOLD[i] = RD;
+
+	if ((!crop.p.IAIRDU) && lsoil.RTDF[i] >= 10.) {
+		// crop failure due to waterlogging
+		fatal[i] = true;
+	} else {
+		if (ZT < 10.) {
+			lsoil.RTDF[i]++;
+		} else {
+			lsoil.RTDF[i] = 0.;
+		}
+	}
+}
+
+
+template class WofostBatchModelT<double>;
+template class WofostBatchModelT<float>;
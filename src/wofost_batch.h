@@ -0,0 +1,218 @@
+/*
+Author: Robert Hijmans
+2026
+
+License: GNU General Public License (GNU GPL) v. 2
+
+Structure-of-arrays version of WofostModel. All simulations share
+the crop and control parameters. Each simulation (a cell and a start
+date) is assigned to a "lane" and all lanes are advanced one day at a
+time through the same weather_step / crop_rates / soil_rates /
+crop_states / soil_states sequence. Lanes that are done are refilled
+from the queue of simulations, or removed when the queue is empty.
+Each lane gives the same result as a WofostModel run for that cell
+with output option "BATCH".
+*/
+
+#ifndef WOFOST_BATCH_H_
+#define WOFOST_BATCH_H_
+
+#include <vector>
+#include <string>
+#include "wofost.h"
+
+
+// weather for all cells; day-major, the value for cell i
+// on day t is at [t * ncells + i]
+template <class T>
+class WofostBatchWeather {
+public:
+	virtual ~WofostBatchWeather(){}
+	size_t ncells = 0;
+	std::vector<long> date;
+	std::vector<T> srad, tmin, tmax, prec, wind, vapr;
+};
+
+
+template <class T>
+class WofostBatchAtmosphere {
+public:
+	virtual ~WofostBatchAtmosphere(){}
+	std::vector<unsigned> DOY;
+	std::vector<T> RAIN, AVRAD, TEMP, DTEMP, TMIN, TMAX, E0, ES0, ET0, DAYL, DAYLP, WIND, VAP;
+	std::vector<T> SINLD, COSLD, DSINB, DSINBE, DifPP, ATMTR, ANGOT;
+	// site
+	std::vector<T> latitude, elevation;
+
+	void resize(size_t n);
+	void copy(size_t to, size_t from);
+private:
+	std::vector<std::vector<T>*> fields();
+};
+
+
+template <class T>
+class WofostBatchCrop {
+public:
+	virtual ~WofostBatchCrop(){}
+	// states
+	std::vector<T> RD, RDOLD, GRLV, DWRT, DWLV, DWST, DWSO;
+	std::vector<T> DVS, LAI, LAIEXP, SAI, PAI, WRT, WLV, WST, WSO;
+	std::vector<T> TWRT, TWLV, TWST, TWSO, TAGP, TSUM, TSUME, TADW;
+	// rates
+	std::vector<T> GASS, GWST, GWSO, DRST, DRLV, DRRT, GWRT, DRSO;
+	std::vector<T> DVR, DTSUME, DTSUM, GLAIEX, RR, FYSDEL;
+	// variables
+	std::vector<char> alive;
+	std::vector<int> IDANTH;
+	std::vector<T> EFF, AMAX, PGASS, RFTRA, TRANRF, LASUM, KDif, TRAMX;
+	std::vector<T> Fr, Fl, Fs, Fo, TRA, TMINRA, DSLV, SLAT, PMRES;
+	// 7 values per lane
+	std::vector<T> TMNSAV;
+
+	// leaf classes, stored by day of formation (0 is the leaves
+	// present at emergence), nclass per lane. The living classes
+	// of lane i are LVOLD[i] (oldest) to LVNEW[i] (youngest)
+	size_t nclass = 0;
+	std::vector<T> LV, SLA, LVAGE;
+	std::vector<size_t> LVOLD, LVNEW;
+
+	void resize(size_t n, size_t classes);
+	void copy(size_t to, size_t from);
+private:
+	std::vector<std::vector<T>*> fields();
+};
+
+
+template <class T>
+class WofostBatchSoil {
+public:
+	virtual ~WofostBatchSoil(){}
+	// index in the (prepared) soil collection
+	std::vector<size_t> sidx;
+	// rates
+	std::vector<T> EVS, EVW, CR, DMAX, DZ;
+	std::vector<T> RIN, RINold, RIRR, DW, PERC, LOSS, DWLOW;
+	// states
+	std::vector<T> SM, ss, W, WI, DSLR, WLOW, WLOWI, WWLOW;
+	// variables
+	std::vector<T> RDM, EVWMX, EVSMX;
+	std::vector<T> RTDF, ZT, SUBAIR, WZ, WZI, WE, WEDTOT, PF;
+
+	void resize(size_t n);
+	void copy(size_t to, size_t from);
+private:
+	std::vector<std::vector<T>*> fields();
+};
+
+
+// soil parameters of a cell that replace those of its soil if >= 0
+class WofostSoilOverlay {
+public:
+	double RDMSOL = -1, ZTI = -1, WAV = -1;
+};
+
+
+// a simulation: a cell and a start date (index in mstart), and the
+// time index of the start date in the weather data
+class WofostBatchJob {
+public:
+	size_t cell, sim;
+	unsigned start;
+};
+
+
+// T is the type used for the weather and the lane state (double or float)
+template <class T>
+class WofostBatchModelT {
+public:
+	virtual ~WofostBatchModelT(){}
+
+	// shared by all cells
+	WofostCrop crop;
+	WofostControl control;
+	// not copied; must outlive run()
+	const WofostSoilCollection *soils = NULL;
+	WofostBatchWeather<T> wth;
+
+	// per cell
+	std::vector<double> latitude, elevation;
+	// soil for each cell (index in soils), and the cell's own soil
+	// parameters (may be empty if there are none)
+	std::vector<int> soilindex;
+	std::vector<WofostSoilOverlay> overlay;
+
+	std::vector<std::string> messages;
+	bool fatalError=false;
+
+	// the maximum number of lanes (simulations done at the same time);
+	// 0 for no maximum
+	size_t maxlanes = 4096;
+
+	// simulate all cells for each start date; returns the last recorded
+	// WSO for start date j and cell i at [j * ncells + i] (NAN if the
+	// run failed)
+	std::vector<double> run(const std::vector<long> &mstart);
+
+	// queue of simulations
+	std::vector<WofostBatchJob> jobs;
+	size_t nextjob = 0;
+
+	// lane state; lanes 0 to nlanes-1 are in use
+	size_t nlanes = 0;
+	std::vector<size_t> job, cell;
+	std::vector<unsigned> time, step, cropstart_step, maxdur, emergence;
+	std::vector<int> ISTATE;
+	std::vector<char> phase, fatal;
+	std::vector<T> yield;
+
+	WofostBatchAtmosphere<T> latm;
+	WofostBatchCrop<T> lcrop;
+	WofostBatchSoil<T> lsoil;
+
+	// the soils compiled for this crop and control: with the adjustments
+	// made in the water balance initialization and the groundwater tables;
+	// not changed by the simulations. These point into soils, or into
+	// changed for the soils that were adjusted
+	std::vector<const WofostSoil*> psoils;
+	std::vector<WofostSoil> changed;
+	// maximum deviation of the tabulated capillary flow from SUBSOL
+	double FLOWDEV = 0;
+
+	bool prepare();
+	void lane_initialize(size_t i, size_t k);
+	void lane_copy(size_t to, size_t from);
+	void refill(std::vector<double> &out);
+	void compact();
+	void crop_initialize(size_t i);
+
+	void day();
+
+	void weather_step(char p);
+	void crop_rates(char p);
+	void crop_states(char p);
+	void soil_rates(char p);
+	void soil_states(char p);
+	void advance(char p);
+
+	void ASTRO(size_t i);
+	void PENMAN(size_t i);
+	void PENMAN_MONTEITH(size_t i);
+	void EVTRA(size_t i);
+	T TOTASS(size_t i);
+
+	void WATPP_rates(size_t i);
+	void WATFD_rates(size_t i);
+	void WATGW_rates(size_t i);
+	void WATFD_states(size_t i);
+	void WATGW_states(size_t i);
+};
+
+
+typedef WofostBatchModelT<double> WofostBatchModel;
+typedef WofostBatchModelT<float> WofostBatchModelFloat;
+
+// lane phases
+enum {LANE_SOIL = 0, LANE_CROP = 1, LANE_FALLOW = 2, LANE_DONE = 3, LANE_EMPTY = 4};
+
+#endif